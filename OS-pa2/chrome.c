@@ -0,0 +1,367 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "trace.h"
+#include "chrome.h"
+
+/**
+ * Groups of tracks, which are shown as processes in the viewer
+ */
+enum chrome_group
+{
+	GROUP_PROCESSES = 1,
+	GROUP_CPUS,
+	GROUP_RESOURCES,
+};
+
+enum chrome_state
+{
+	STATE_NONE,
+	STATE_READY,
+	STATE_RUNNING, /* Running from @since until @until */
+	STATE_BLOCKED,
+	STATE_WOKEN,   /* Blocked from @since, and ready from @until */
+	STATE_EXITED,
+};
+
+/**
+ * State of a track. @owner is the process running on a CPU track or owning
+ * a resource track. CPUs and resources are STATE_RUNNING while they are
+ * used by @owner, and a resource is STATE_WOKEN once it is released at
+ * @until but the slice is not closed yet
+ */
+struct chrome_track
+{
+	uint8_t state;
+	bool named;
+	uint16_t cpu;
+	uint32_t owner;
+	uint32_t since;
+	uint32_t until;
+};
+
+static const char *__state_names[] = {
+	[STATE_READY] = "ready",
+	[STATE_RUNNING] = "running",
+	[STATE_BLOCKED] = "blocked",
+};
+
+static const char *__group_names[] = {
+	[GROUP_PROCESSES] = "Processes",
+	[GROUP_CPUS] = "CPUs",
+	[GROUP_RESOURCES] = "Resources",
+};
+
+static void __begin_event(struct chrome *c)
+{
+	fprintf(c->stream, c->first ? "\n" : ",\n");
+	c->first = false;
+}
+
+static void __slice(struct chrome *c, enum chrome_group group, unsigned int tid,
+					const char *name, unsigned int pid, unsigned int from, unsigned int to)
+{
+	if (from >= to)
+		return;
+
+	__begin_event(c);
+	fprintf(c->stream, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,"
+					   "\"pid\":%d,\"tid\":%u,\"args\":{\"pid\":%u}}",
+			name, (unsigned long long)from * CHROME_US_PER_TICK,
+			(unsigned long long)(to - from) * CHROME_US_PER_TICK, group, tid, pid);
+}
+
+static void __instant(struct chrome *c, unsigned int pid, const char *name,
+					  const char *arg, int value, unsigned int tick)
+{
+	__begin_event(c);
+	fprintf(c->stream, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,"
+					   "\"pid\":%d,\"tid\":%u,\"args\":{\"%s\":%d}}",
+			name, (unsigned long long)tick * CHROME_US_PER_TICK,
+			GROUP_PROCESSES, pid, arg, value);
+}
+
+/**
+ * Get the track @id of a group, growing the @tracks as needed. Name the
+ * track in the viewer at the first time
+ */
+static struct chrome_track *__track(struct chrome *c, enum chrome_group group,
+									struct chrome_track **tracks, unsigned int *nr,
+									unsigned int id)
+{
+	static const char *prefixes[] = {
+		[GROUP_PROCESSES] = "Process",
+		[GROUP_CPUS] = "CPU",
+		[GROUP_RESOURCES] = "Resource",
+	};
+	struct chrome_track *t;
+
+	if (id >= *nr)
+	{
+		unsigned int size = *nr ? *nr : 16;
+
+		while (size <= id)
+			size *= 2;
+
+		*tracks = realloc(*tracks, sizeof(**tracks) * size);
+		assert(*tracks);
+		memset(*tracks + *nr, 0x00, sizeof(**tracks) * (size - *nr));
+		*nr = size;
+	}
+
+	t = *tracks + id;
+	if (!t->named)
+	{
+		__begin_event(c);
+		fprintf(c->stream, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+						   "\"args\":{\"name\":\"%s %u\"}}",
+				group, id, prefixes[group], id);
+		t->named = true;
+	}
+	return t;
+}
+
+#define __process(c, pid) \
+	__track(c, GROUP_PROCESSES, &(c)->processes, &(c)->nr_processes, pid)
+#define __cpu(c, id) \
+	__track(c, GROUP_CPUS, &(c)->cpus, &(c)->nr_cpus, id)
+#define __resource(c, id) \
+	__track(c, GROUP_RESOURCES, &(c)->resources, &(c)->nr_resources, id)
+
+/**
+ * Close the slice of the current state of process @pid at @tick and get it
+ * into @state
+ */
+static void __transit(struct chrome *c, unsigned int pid, enum chrome_state state,
+					  unsigned int tick)
+{
+	struct chrome_track *p = __process(c, pid);
+	unsigned int ready = tick;
+
+	switch (p->state)
+	{
+	case STATE_READY:
+	case STATE_BLOCKED:
+		__slice(c, GROUP_PROCESSES, pid, __state_names[p->state], pid, p->since, tick);
+		break;
+	case STATE_RUNNING:
+		__slice(c, GROUP_PROCESSES, pid, "running", pid, p->since, p->until);
+		ready = p->until;
+		break;
+	case STATE_WOKEN:
+		__slice(c, GROUP_PROCESSES, pid, "blocked", pid, p->since,
+				p->until < tick ? p->until : tick);
+		ready = p->until;
+		break;
+	default:
+		break;
+	}
+
+	/* Ready in between */
+	if (p->state == STATE_RUNNING || p->state == STATE_WOKEN)
+		__slice(c, GROUP_PROCESSES, pid, "ready", pid, ready, tick);
+
+	p->state = state;
+	p->since = tick;
+}
+
+static void __run(struct chrome *c, const struct trace_event *ev)
+{
+	struct chrome_track *p = __process(c, ev->pid);
+	unsigned int until = ev->tick + ev->arg;
+
+	if (p->state == STATE_RUNNING && p->until == ev->tick && p->cpu == ev->cpu)
+	{
+		p->until = until;
+	}
+	else
+	{
+		__transit(c, ev->pid, STATE_RUNNING, ev->tick);
+		p->until = until;
+		p->cpu = ev->cpu;
+	}
+
+	if (c->multi_cpu)
+	{
+		struct chrome_track *cpu = __cpu(c, ev->cpu);
+		char name[32];
+
+		if (cpu->state == STATE_RUNNING && cpu->owner == ev->pid && cpu->until == ev->tick)
+		{
+			cpu->until = until;
+			return;
+		}
+
+		if (cpu->state == STATE_RUNNING)
+		{
+			snprintf(name, sizeof(name), "Process %u", cpu->owner);
+			__slice(c, GROUP_CPUS, ev->cpu, name, cpu->owner, cpu->since, cpu->until);
+		}
+		cpu->state = STATE_RUNNING;
+		cpu->owner = ev->pid;
+		cpu->since = ev->tick;
+		cpu->until = until;
+	}
+}
+
+/**
+ * Close the ownership of resource @resource_id at @tick, or at its release
+ * if it is released earlier. It is released at the end of the tick, but
+ * another CPU may acquire it in the tick
+ */
+static void __disown(struct chrome *c, int resource_id, unsigned int tick)
+{
+	struct chrome_track *r = __resource(c, resource_id);
+	char name[32];
+
+	if (r->state == STATE_NONE)
+		return;
+
+	if (r->state == STATE_WOKEN && r->until < tick)
+		tick = r->until;
+
+	snprintf(name, sizeof(name), "Process %u", r->owner);
+	__slice(c, GROUP_RESOURCES, resource_id, name, r->owner, r->since, tick);
+	r->state = STATE_NONE;
+}
+
+void chrome_begin(struct chrome *c, FILE *stream, bool multi_cpu)
+{
+	memset(c, 0x00, sizeof(*c));
+	c->stream = stream;
+	c->multi_cpu = multi_cpu;
+	c->first = true;
+
+	fprintf(stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	for (enum chrome_group g = GROUP_PROCESSES; g <= GROUP_RESOURCES; g++)
+	{
+		if (g == GROUP_CPUS && !multi_cpu)
+			continue;
+
+		__begin_event(c);
+		fprintf(stream, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+						"\"args\":{\"name\":\"%s\"}}",
+				g, __group_names[g]);
+	}
+}
+
+void chrome_event(struct chrome *c, const struct trace_event *ev)
+{
+	unsigned int end = ev->tick + (ev->type == TRACE_RUN ? ev->arg : 0);
+
+	if (end > c->now)
+		c->now = end;
+
+	switch (ev->type)
+	{
+	case TRACE_FORK:
+		__transit(c, ev->pid, STATE_READY, ev->tick);
+		__instant(c, ev->pid, "fork", "cpu", ev->cpu, ev->tick);
+		break;
+	case TRACE_EXIT:
+		__transit(c, ev->pid, STATE_EXITED, ev->tick);
+		__instant(c, ev->pid, "exit", "cpu", ev->cpu, ev->tick);
+		break;
+	case TRACE_RUN:
+		__run(c, ev);
+		break;
+	case TRACE_BLOCK:
+		__transit(c, ev->pid, STATE_BLOCKED, ev->tick);
+		break;
+	case TRACE_WAKE:
+	{
+		struct chrome_track *p = __process(c, ev->pid);
+
+		/* Woken up at the end of the tick */
+		if (p->state == STATE_BLOCKED)
+		{
+			p->state = STATE_WOKEN;
+			p->until = ev->tick + 1;
+		}
+		break;
+	}
+	case TRACE_ACQUIRE:
+	{
+		struct chrome_track *r = __resource(c, ev->arg);
+
+		__instant(c, ev->pid, "acquire", "resource", ev->arg, ev->tick);
+		__disown(c, ev->arg, ev->tick);
+		r->state = STATE_RUNNING;
+		r->owner = ev->pid;
+		r->since = ev->tick;
+		break;
+	}
+	case TRACE_RELEASE:
+	{
+		struct chrome_track *r = __resource(c, ev->arg);
+
+		__instant(c, ev->pid, "release", "resource", ev->arg, ev->tick);
+		if (r->state == STATE_RUNNING)
+		{
+			r->state = STATE_WOKEN;
+			r->until = ev->tick + 1;
+		}
+		break;
+	}
+	case TRACE_MIGRATE:
+		__instant(c, ev->pid, "migrate", "cpu", ev->cpu, ev->tick);
+		break;
+	case TRACE_IDLE:
+	default:
+		break;
+	}
+}
+
+int chrome_end(struct chrome *c)
+{
+	/* Close the slices left open */
+	for (unsigned int pid = 0; pid < c->nr_processes; pid++)
+	{
+		if (c->processes[pid].named)
+			__transit(c, pid, STATE_NONE, c->now);
+	}
+	for (unsigned int i = 0; i < c->nr_cpus; i++)
+	{
+		struct chrome_track *cpu = c->cpus + i;
+		char name[32];
+
+		if (cpu->state != STATE_RUNNING)
+			continue;
+
+		snprintf(name, sizeof(name), "Process %u", cpu->owner);
+		__slice(c, GROUP_CPUS, i, name, cpu->owner, cpu->since, cpu->until);
+	}
+	for (unsigned int i = 0; i < c->nr_resources; i++)
+	{
+		if (c->resources[i].named)
+			__disown(c, i, c->now);
+	}
+
+	fprintf(c->stream, "\n]}\n");
+
+	free(c->processes);
+	free(c->cpus);
+	free(c->resources);
+
+	return ferror(c->stream) ? -1 : 0;
+}
@@ -0,0 +1,68 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __CHROME_H__
+#define __CHROME_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "types.h"
+
+struct trace_event;
+
+/**
+ * A tick is shown as a millisecond in the viewer
+ */
+#define CHROME_US_PER_TICK 1000
+
+/***********************************************************************
+ * struct chrome
+ *
+ * DESCRIPTION
+ *   Exporter of trace events into the Chrome trace event format, which
+ *   chrome://tracing and Perfetto can load. There are a track for each
+ *   process with running, ready, and blocked slices and instant events for
+ *   fork, exit, migration and resource acquire/release, a track for each
+ *   CPU if there are many, and a track for each resource showing which
+ *   process owns it.
+ *
+ *   The events are written out as soon as their slices are closed. So, it
+ *   only keeps the state of each process, CPU, and resource, but not the
+ *   events.
+ */
+struct chrome_track;
+
+struct chrome
+{
+	FILE *stream;
+	bool multi_cpu;
+	bool first;		 /* No event is written yet */
+	unsigned int now; /* The end of the last event */
+
+	struct chrome_track *processes;
+	unsigned int nr_processes;
+	struct chrome_track *cpus;
+	unsigned int nr_cpus;
+	struct chrome_track *resources;
+	unsigned int nr_resources;
+};
+
+void chrome_begin(struct chrome *c, FILE *stream, bool multi_cpu);
+void chrome_event(struct chrome *c, const struct trace_event *ev);
+int chrome_end(struct chrome *c);
+
+#endif
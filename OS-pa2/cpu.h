@@ -0,0 +1,54 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+struct process;
+struct list_head;
+
+/**
+ * Processors in the system. The number of processors is given with -n
+ * option (1 by default).
+ *
+ * The framework works on one CPU at a time. While working on a CPU, the
+ * framework makes @current and @readyqueue refer to those of the CPU, and
+ * points the CPU with @this_cpu. So, the scheduling policies can use
+ * @current and @readyqueue as they do on the single processor system.
+ */
+struct cpu
+{
+	unsigned int id;
+
+	/**
+	 * The process running on the CPU and the processes ready to run on the
+	 * CPU. Do not access them directly but use @current and @readyqueue.
+	 */
+	struct process *__current;
+	struct list_head __readyqueue;
+
+	/**
+	 * Per-CPU data of the scheduling policy. The policy may set this in its
+	 * initialize() callback, which is called once for each CPU.
+	 */
+	void *private;
+};
+
+/**
+ * The CPU that the framework is working on (@this_cpu) and the number of CPUs
+ * in the system (@nr_cpus) are defined in pa2sim.h
+ */
+
+#endif
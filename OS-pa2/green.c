@@ -0,0 +1,618 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/* ucontext and clock_gettime() need more than the Makefile asks for */
+#undef _POSIX_C_SOURCE
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+
+#include "process.h"
+#include "resource.h"
+#include "cpu.h"
+#include "green.h"
+
+/* Names like @resources and @nr_cpus below are of the runtime's simulation */
+#include "simulation.h"
+
+#include "sched.h"
+
+/**
+ * The policies work on the simulation that this thread is running. All the
+ * workers run the one in @green, which stands for the runtime. So, this takes
+ * the place of sched.c for the policies in pa2.c
+ */
+__thread struct simulation *this_sim = NULL;
+
+#define GREEN_STACK_SIZE (64 << 10)
+
+/**
+ * What a task asks its worker for when it gives up the worker
+ */
+enum green_request
+{
+	GREEN_RUN, /* Nothing. Keep running */
+	GREEN_YIELD,
+	GREEN_ACQUIRE,
+	GREEN_RELEASE,
+	GREEN_EXIT,
+};
+
+struct green_task
+{
+	struct process process; /* What the policy schedules */
+
+	ucontext_t context;
+	void *stack;
+	void (*fn)(void *);
+	void *arg;
+
+	struct green_worker *worker; /* The worker running the task */
+
+	enum green_request request;
+	int resource_id;
+	enum resource_mode mode;
+
+	struct list_head all; /* Linked into green.tasks */
+};
+
+struct green_worker
+{
+	pthread_t thread;
+	struct cpu *cpu;
+	ucontext_t context;
+
+	struct green_task *task; /* The task running on this worker */
+
+	/* When the last task gave up this worker. 0 if the worker has idled */
+	unsigned long long switched_at;
+
+	struct green_stats stats;
+};
+
+static struct
+{
+	struct simulation sim;
+
+	struct green_worker *workers;
+	unsigned int nr_workers;
+
+	pthread_mutex_t lock; /* Serializes the policy callbacks */
+	pthread_cond_t idle;  /* Idle workers wait for the tasks to be ready */
+	unsigned int nr_idle;
+	unsigned int nr_busy; /* # of workers running a task */
+
+	struct list_head tasks;
+	unsigned int nr_tasks; /* # of tasks not exited */
+	unsigned int next_pid;
+	unsigned int next_cpu; /* The CPU to spawn the next task on */
+
+	bool done;
+	bool stuck;
+} green;
+
+static __thread struct green_worker *this_worker = NULL;
+
+static inline struct green_task *__task_of(struct process *p)
+{
+	return container_of(p, struct green_task, process);
+}
+
+static inline unsigned long long __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void report_deadlock(struct process *p)
+{
+	struct process *q = p;
+
+	fprintf(stderr, "Deadlock: task %u", p->pid);
+	do
+	{
+		fprintf(stderr, " -> resource %d -> task %u",
+				(int)(q->waiting_for - this_sim->resources),
+				q->waiting_for->owner->pid);
+		q = q->waiting_for->owner;
+	} while (q != p);
+	fprintf(stderr, "\n");
+
+	this_sim->deadlocked = true;
+}
+
+/**
+ * Make @current and @readyqueue refer to those of @cpu. See sched.c
+ */
+static void __switch_to_cpu(struct cpu *cpu)
+{
+	if (cpu == this_sim->this_cpu)
+		return;
+
+	if (this_sim->this_cpu)
+	{
+		this_sim->this_cpu->__current = this_sim->current;
+		list_splice_init(&this_sim->readyqueue,
+						 &this_sim->this_cpu->__readyqueue);
+	}
+
+	this_sim->this_cpu = cpu;
+	this_sim->current = cpu->__current;
+	list_splice_init(&cpu->__readyqueue, &this_sim->readyqueue);
+}
+
+static inline void __wake_idle(void)
+{
+	if (green.nr_idle)
+		pthread_cond_signal(&green.idle);
+}
+
+/***********************************************************************
+ * Task side
+ */
+static void __account_switch(struct green_worker *w)
+{
+	if (!w->switched_at)
+		return;
+
+	w->stats.nr_switches++;
+	w->stats.switch_ns += __now() - w->switched_at;
+}
+
+/**
+ * Give up the worker with @request, and come back when the worker is done
+ * with it. @t may come back on another worker, so do not look into the
+ * thread-local variables after the switch
+ */
+static void __green_switch(struct green_task *t, enum green_request request)
+{
+	struct green_worker *w = t->worker;
+
+	t->request = request;
+	w->switched_at = __now();
+	swapcontext(&t->context, &w->context);
+
+	__account_switch(t->worker);
+}
+
+static void __green_entry(void)
+{
+	struct green_task *t = this_worker->task;
+
+	__account_switch(t->worker);
+
+	t->fn(t->arg);
+
+	__green_switch(t, GREEN_EXIT);
+	assert(!"An exited task is resumed");
+}
+
+void green_yield(void)
+{
+	__green_switch(this_worker->task, GREEN_YIELD);
+}
+
+void green_acquire(int resource_id, enum resource_mode mode)
+{
+	struct green_task *t = this_worker->task;
+
+	t->resource_id = resource_id;
+	t->mode = mode;
+	__green_switch(t, GREEN_ACQUIRE);
+}
+
+void green_release(int resource_id)
+{
+	struct green_task *t = this_worker->task;
+
+	t->resource_id = resource_id;
+	__green_switch(t, GREEN_RELEASE);
+}
+
+/***********************************************************************
+ * Worker side. Everything here runs with @green.lock held, on the CPU of
+ * the worker
+ */
+
+/**
+ * Carry out what @t, the current, asks for. Return true if @t keeps running
+ */
+static bool __serve(struct green_task *t)
+{
+	struct process *p = &t->process;
+
+	switch (t->request)
+	{
+	case GREEN_RUN:
+		return true;
+
+	case GREEN_YIELD:
+		/* A yield is a tick of the task */
+		this_sim->ticks++;
+		if (++p->age >= p->lifespan)
+			p->lifespan = p->age + 1;
+		return false;
+
+	case GREEN_ACQUIRE:
+		if (this_sim->sched->acquire(t->resource_id, t->mode))
+		{
+			t->request = GREEN_RUN;
+			return true;
+		}
+		this_worker->stats.nr_blocked++;
+		return false;
+
+	case GREEN_RELEASE:
+		this_sim->sched->release(t->resource_id);
+		t->request = GREEN_RUN;
+		__wake_idle();
+		return true;
+
+	case GREEN_EXIT:
+		/* So that the policy lets it go */
+		p->lifespan = p->age;
+		return false;
+	}
+	return false;
+}
+
+static void __put_prev(struct process *prev)
+{
+	struct green_task *t = __task_of(prev);
+
+	if (prev->status == PROCESS_RUNNING)
+		prev->status = PROCESS_READY;
+
+	if (t->request != GREEN_EXIT)
+		return;
+
+	assert(list_empty(&prev->list));
+	prev->status = PROCESS_EXIT;
+	if (this_sim->sched->exiting)
+		this_sim->sched->exiting(prev);
+
+	list_del(&t->all);
+	free(t->stack);
+	free(t);
+	green.nr_tasks--;
+}
+
+/**
+ * Steal a ready task from other CPUs for this idle one. See sched.c
+ */
+static bool __steal(void)
+{
+	struct cpu *thief = this_sim->this_cpu;
+	struct process *p = NULL;
+
+	for (unsigned int i = 1; i < this_sim->nr_cpus && !p; i++)
+	{
+		__switch_to_cpu(this_sim->cpus +
+						(thief->id + i) % this_sim->nr_cpus);
+
+		if (this_sim->sched->detach)
+		{
+			p = this_sim->sched->detach();
+		}
+		else if (!list_empty(&this_sim->readyqueue))
+		{
+			p = list_first_entry(&this_sim->readyqueue,
+								 struct process, list);
+			list_del_init(&p->list);
+		}
+	}
+	__switch_to_cpu(thief);
+
+	if (!p)
+		return false;
+
+	list_add_tail(&p->list, &this_sim->readyqueue);
+	if (this_sim->sched->attach)
+		this_sim->sched->attach(p);
+
+	this_worker->stats.nr_stolen++;
+	return true;
+}
+
+/**
+ * Ask the policy for the task to run next, which has gone through the
+ * resource it was blocked on. NULL if nothing is ready to run
+ */
+static struct green_task *__pick_next(void)
+{
+	while (true)
+	{
+		struct process *prev = this_sim->current;
+		struct green_task *t;
+
+		this_sim->current = this_sim->sched->schedule();
+		if (prev)
+			__put_prev(prev);
+
+		if (!this_sim->current && __steal())
+			this_sim->current = this_sim->sched->schedule();
+
+		if (!this_sim->current)
+			return NULL;
+
+		this_sim->current->status = PROCESS_RUNNING;
+
+		/* A task woken up tries acquiring the resource again */
+		t = __task_of(this_sim->current);
+		if (t->request != GREEN_ACQUIRE || __serve(t))
+			return t;
+	}
+}
+
+static void *__green_worker(void *arg)
+{
+	struct green_worker *w = arg;
+	struct green_task *t = NULL;
+
+	this_sim = &green.sim;
+	this_worker = w;
+
+	pthread_mutex_lock(&green.lock);
+	while (true)
+	{
+		__switch_to_cpu(w->cpu);
+
+		/* @t has just given up this worker */
+		if (!t || !__serve(t))
+			t = __pick_next();
+
+		if (this_sim->deadlocked)
+		{
+			green.done = green.stuck = true;
+			pthread_cond_broadcast(&green.idle);
+		}
+
+		if (!t)
+		{
+			/* Nothing runs nor is ready anywhere, so nothing will be */
+			if (!green.nr_busy)
+			{
+				green.stuck = green.nr_tasks > 0;
+				green.done = true;
+				pthread_cond_broadcast(&green.idle);
+			}
+			if (green.done)
+				break;
+
+			w->switched_at = 0;
+			green.nr_idle++;
+			pthread_cond_wait(&green.idle, &green.lock);
+			green.nr_idle--;
+			continue;
+		}
+		if (green.done)
+			break;
+
+		t->request = GREEN_RUN;
+		t->worker = w;
+		w->task = t;
+		green.nr_busy++;
+		pthread_mutex_unlock(&green.lock);
+
+		swapcontext(&w->context, &t->context);
+
+		pthread_mutex_lock(&green.lock);
+		green.nr_busy--;
+	}
+	pthread_mutex_unlock(&green.lock);
+
+	return NULL;
+}
+
+/***********************************************************************
+ * Runtime
+ */
+int green_init(const struct scheduler *policy, unsigned int nr_workers, unsigned int nr)
+{
+	assert(policy->schedule && "scheduler.schedule() not implemented");
+	assert(nr_workers >= 1);
+
+	memset(&green, 0x00, sizeof(green));
+	pthread_mutex_init(&green.lock, NULL);
+	pthread_cond_init(&green.idle, NULL);
+	INIT_LIST_HEAD(&green.tasks);
+	green.next_pid = 1;
+
+	this_sim = &green.sim;
+	this_sim->sched = policy;
+	this_sim->quiet = true;
+	this_sim->events = stderr;
+	this_sim->metrics_format = -1;
+	INIT_LIST_HEAD(&this_sim->readyqueue);
+
+	this_sim->nr_cpus = nr_workers;
+	this_sim->cpus = malloc(sizeof(*this_sim->cpus) * nr_workers);
+	green.workers = calloc(nr_workers, sizeof(*green.workers));
+	green.nr_workers = nr_workers;
+	assert(this_sim->cpus && green.workers);
+
+	for (unsigned int i = 0; i < nr_workers; i++)
+	{
+		this_sim->cpus[i].id = i;
+		this_sim->cpus[i].__current = NULL;
+		INIT_LIST_HEAD(&this_sim->cpus[i].__readyqueue);
+		this_sim->cpus[i].private = NULL;
+		green.workers[i].cpu = this_sim->cpus + i;
+	}
+
+	this_sim->nr_resources = nr;
+	this_sim->resources = calloc(nr ? nr : 1, sizeof(*this_sim->resources));
+	assert(this_sim->resources);
+	for (unsigned int i = 0; i < this_sim->nr_resources; i++)
+	{
+		this_sim->resources[i].units = 1;
+		this_sim->resources[i].batch = UINT_MAX;
+		INIT_LIST_HEAD(&(this_sim->resources[i].waitqueue));
+		INIT_LIST_HEAD(&(this_sim->resources[i].held_list));
+	}
+
+	for (unsigned int i = 0; i < nr_workers; i++)
+	{
+		__switch_to_cpu(this_sim->cpus + i);
+		if (this_sim->sched->initialize && this_sim->sched->initialize())
+			return -1;
+	}
+	return 0;
+}
+
+void green_fini(void)
+{
+	struct green_task *t, *tmp;
+
+	for (unsigned int i = 0; i < this_sim->nr_cpus; i++)
+	{
+		__switch_to_cpu(this_sim->cpus + i);
+		if (this_sim->sched->finalize)
+			this_sim->sched->finalize();
+	}
+
+	/* The tasks left behind by a deadlock */
+	list_for_each_entry_safe(t, tmp, &green.tasks, all)
+	{
+		free(t->stack);
+		free(t);
+	}
+
+	for (unsigned int i = 0; i < this_sim->nr_resources; i++)
+	{
+		free(this_sim->resources[i].waiters);
+	}
+	free(this_sim->resources);
+	free(this_sim->cpus);
+	free(green.workers);
+
+	pthread_cond_destroy(&green.idle);
+	pthread_mutex_destroy(&green.lock);
+	this_sim = NULL;
+}
+
+void green_resource(int resource_id, unsigned int units, unsigned int batch)
+{
+	assert(resource_id >= 0 && resource_id < this_sim->nr_resources &&
+		   units >= 1);
+
+	this_sim->resources[resource_id].units = units;
+	this_sim->resources[resource_id].batch = batch;
+}
+
+int green_spawn(void (*fn)(void *), void *arg, unsigned int prio, unsigned int lifespan)
+{
+	struct green_task *t = calloc(1, sizeof(*t));
+	struct process *p = &t->process;
+
+	if (!t)
+		return -1;
+
+	t->stack = malloc(GREEN_STACK_SIZE);
+	if (!t->stack || getcontext(&t->context))
+	{
+		free(t->stack);
+		free(t);
+		return -1;
+	}
+	t->context.uc_stack.ss_sp = t->stack;
+	t->context.uc_stack.ss_size = GREEN_STACK_SIZE;
+	t->context.uc_link = NULL;
+	makecontext(&t->context, __green_entry, 0);
+
+	t->fn = fn;
+	t->arg = arg;
+	t->request = GREEN_RUN;
+
+	p->lifespan = lifespan ? lifespan : UINT_MAX;
+	p->prio = p->prio_orig = prio;
+	p->deadline = UINT_MAX;
+	INIT_LIST_HEAD(&p->list);
+	INIT_LIST_HEAD(&p->held);
+	INIT_LIST_HEAD(&p->__resources_to_acquire);
+	INIT_LIST_HEAD(&p->__resources_holding);
+	INIT_LIST_HEAD(&p->__blocked_list);
+
+	pthread_mutex_lock(&green.lock);
+
+	p->pid = green.next_pid++;
+	list_add_tail(&t->all, &green.tasks);
+	green.nr_tasks++;
+
+	/* Spread new tasks over CPUs as the simulation does */
+	__switch_to_cpu(this_sim->cpus + green.next_cpu);
+	green.next_cpu = (green.next_cpu + 1) % this_sim->nr_cpus;
+
+	list_add_tail(&p->list, &this_sim->readyqueue);
+	p->status = PROCESS_READY;
+	if (this_sim->sched->forked)
+		this_sim->sched->forked(p);
+
+	__wake_idle();
+	pthread_mutex_unlock(&green.lock);
+
+	return 0;
+}
+
+int green_run(struct green_stats *stats)
+{
+	unsigned long long started_at = __now();
+
+	green.done = green.stuck = false;
+
+	for (unsigned int i = 0; i < green.nr_workers; i++)
+	{
+		if (pthread_create(&green.workers[i].thread, NULL, __green_worker, green.workers + i))
+		{
+			fprintf(stderr, "Cannot start worker %u\n", i);
+			abort();
+		}
+	}
+
+	for (unsigned int i = 0; i < green.nr_workers; i++)
+	{
+		pthread_join(green.workers[i].thread, NULL);
+	}
+
+	if (stats)
+	{
+		memset(stats, 0x00, sizeof(*stats));
+		for (unsigned int i = 0; i < green.nr_workers; i++)
+		{
+			struct green_stats *s = &green.workers[i].stats;
+
+			stats->nr_switches += s->nr_switches;
+			stats->switch_ns += s->switch_ns;
+			stats->nr_blocked += s->nr_blocked;
+			stats->nr_stolen += s->nr_stolen;
+		}
+		stats->elapsed_ns = __now() - started_at;
+	}
+
+	return green.stuck ? -1 : 0;
+}
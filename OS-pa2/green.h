@@ -0,0 +1,91 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __GREEN_H__
+#define __GREEN_H__
+
+#include "list_head.h"
+#include "resource.h"
+
+struct scheduler;
+
+/***********************************************************************
+ * Green threads
+ *
+ * DESCRIPTION
+ *   User-level tasks multiplexed on a pool of worker threads (M:N), and
+ *   scheduled by the same struct scheduler policies as the simulation.
+ *   Each worker is a CPU to the policy, and each task is a process;
+ *
+ *   - A task ages by one tick whenever it calls green_yield(), and the
+ *     policy's schedule() picks the task to run on the worker next.
+ *   - green_acquire() and green_release() go to the policy's acquire()
+ *     and release(). A task blocked in green_acquire() tries again when
+ *     the policy wakes it up and it is scheduled, as in the simulation.
+ *   - @lifespan of a task is the number of yields it is expected to make.
+ *     The policies like SJF and SRTF take it as is, and it is stretched
+ *     when the task yields more than that. 0 if unknown.
+ *
+ *   The policy callbacks run in the worker threads under one lock, and
+ *   the tasks run outside of it. Tasks switch with ucontext.
+ */
+
+/**
+ * Statistics of a run. A switch is from a task giving up a worker until the
+ * next task (maybe the same one) resumes on the worker, which includes the
+ * scheduling decision of the policy
+ */
+struct green_stats
+{
+	unsigned long long nr_switches;
+	unsigned long long switch_ns;
+	unsigned long long nr_blocked; /* # of green_acquire() that blocked */
+	unsigned long long nr_stolen;  /* # of tasks migrated to idle workers */
+	unsigned long long elapsed_ns;
+};
+
+/**
+ * Set up the runtime to run the tasks on @nr_workers workers with @policy,
+ * with @nr_resources resources of which all are mutexes. Return 0 on success
+ */
+int green_init(const struct scheduler *policy, unsigned int nr_workers, unsigned int nr_resources);
+void green_fini(void);
+
+/**
+ * Make resource @resource_id have @units units and let in @batch readers
+ * ahead of a waiting writer. See struct resource
+ */
+void green_resource(int resource_id, unsigned int units, unsigned int batch);
+
+/**
+ * Spawn a task running @fn(@arg) with @prio. Tasks can be spawned before
+ * green_run() and by the running tasks. Return 0 on success
+ */
+int green_spawn(void (*fn)(void *), void *arg, unsigned int prio, unsigned int lifespan);
+
+/**
+ * Run the tasks until all of them exit. Return 0 on success, or -1 if the
+ * tasks get stuck on the resources (a deadlock). @stats can be NULL
+ */
+int green_run(struct green_stats *stats);
+
+/**
+ * Calls for the running tasks
+ */
+void green_yield(void);
+void green_acquire(int resource_id, enum resource_mode mode);
+void green_release(int resource_id);
+
+#endif
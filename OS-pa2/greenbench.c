@@ -0,0 +1,256 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "green.h"
+#include "sched.h"
+
+/***********************************************************************
+ * greenbench
+ *
+ * DESCRIPTION
+ *   Run real tasks on the green-thread runtime with the selected policies,
+ *   and report how long a switch between the tasks takes. The tasks are
+ *   CPU-bound ones that spin and yield, or lock-bound ones that also hold
+ *   a resource across a yield every @lock_every yields.
+ */
+extern const struct scheduler fifo_scheduler;
+extern const struct scheduler sjf_scheduler;
+extern const struct scheduler srtf_scheduler;
+extern const struct scheduler rr_scheduler;
+extern const struct scheduler prio_scheduler;
+extern const struct scheduler pa_scheduler;
+extern const struct scheduler pcp_scheduler;
+extern const struct scheduler pip_scheduler;
+extern const struct scheduler cfs_scheduler;
+extern const struct scheduler mlfq_scheduler;
+extern const struct scheduler edf_scheduler;
+extern const struct scheduler stride_scheduler;
+extern const struct scheduler lottery_scheduler;
+
+static struct policy
+{
+	char option;
+	const char *name;
+	const struct scheduler *scheduler;
+} __policies[] = {
+	{'f', "fifo", &fifo_scheduler},
+	{'s', "sjf", &sjf_scheduler},
+	{'S', "srtf", &srtf_scheduler},
+	{'r', "rr", &rr_scheduler},
+	{'p', "prio", &prio_scheduler},
+	{'a', "pa", &pa_scheduler},
+	{'c', "pcp", &pcp_scheduler},
+	{'i', "pip", &pip_scheduler},
+	{'C', "cfs", &cfs_scheduler},
+	{'M', "mlfq", &mlfq_scheduler},
+	{'E', "edf", &edf_scheduler},
+	{'t', "stride", &stride_scheduler},
+	{'l', "lottery", &lottery_scheduler},
+};
+
+#define NR_POLICIES (sizeof(__policies) / sizeof(__policies[0]))
+
+static struct
+{
+	unsigned int nr_workers;
+	unsigned int nr_tasks;
+	unsigned int nr_yields;	  /* # of yields of a task */
+	unsigned int work;		  /* # of spins between yields */
+	unsigned int nr_resources;
+	unsigned int lock_every; /* 0 for the CPU-bound tasks */
+} config = {
+	.nr_workers = 1,
+	.nr_tasks = 64,
+	.nr_yields = 1000,
+	.work = 100,
+	.nr_resources = 4,
+	.lock_every = 0,
+};
+
+static void __spin(unsigned int nr)
+{
+	for (volatile unsigned int i = 0; i < nr; i++)
+		;
+}
+
+static void __cpu_task(void *arg)
+{
+	for (unsigned int i = 0; i < config.nr_yields; i++)
+	{
+		__spin(config.work);
+		green_yield();
+	}
+}
+
+static void __lock_task(void *arg)
+{
+	int resource_id = (int)(long)arg % config.nr_resources;
+
+	for (unsigned int i = 0; i < config.nr_yields; i++)
+	{
+		if (i % config.lock_every)
+		{
+			__spin(config.work);
+			green_yield();
+			continue;
+		}
+
+		/* Hold the resource across a yield so that the others contend */
+		green_acquire(resource_id, RESOURCE_EXCLUSIVE);
+		__spin(config.work);
+		green_yield();
+		green_release(resource_id);
+	}
+}
+
+static int __bench(struct policy *policy)
+{
+	struct green_stats stats;
+	int ret;
+
+	if (green_init(policy->scheduler, config.nr_workers, config.nr_resources))
+	{
+		fprintf(stderr, "Cannot initialize %s\n", policy->name);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < config.nr_tasks; i++)
+	{
+		/* Four priority classes, and the tasks declare how long they run */
+		if (green_spawn(config.lock_every ? __lock_task : __cpu_task, (void *)(long)i,
+						(i % 4) * 10, config.nr_yields))
+		{
+			fprintf(stderr, "Cannot spawn task %u\n", i);
+			green_fini();
+			return -1;
+		}
+	}
+
+	ret = green_run(&stats);
+	green_fini();
+
+	if (ret)
+	{
+		fprintf(stderr, "%s: the tasks got stuck\n", policy->name);
+		return -1;
+	}
+
+	printf("%-8s %12llu %10.1f %10llu %8llu %10.3f\n", policy->name,
+		   stats.nr_switches,
+		   stats.nr_switches ? (double)stats.switch_ns / stats.nr_switches : 0.0,
+		   stats.nr_blocked, stats.nr_stolen, stats.elapsed_ns / 1e6);
+	return 0;
+}
+
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-n workers} {-T tasks} {-Y yields} {-W spins} {-R resources} {-L n} -[f|s|S|r|p|a|c|i|C|M|E|t|l]...\n", name);
+	printf("\n");
+	printf("  -n: Run the tasks on @workers threads (1 by default)\n");
+	printf("  -T: Spawn @tasks tasks (64 by default)\n");
+	printf("  -Y: Each task yields @yields times (1000 by default)\n");
+	printf("  -W: Each task spins @spins times between the yields (100 by default)\n");
+	printf("  -R: The lock-bound tasks share @resources resources (4 by default)\n");
+	printf("  -L: Make the tasks lock-bound; acquire a resource every @n yields\n");
+	printf("\n");
+	printf("  Policies are the same as sched. All of them run if none is given\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	struct policy *policies[NR_POLICIES];
+	unsigned int nr_policies = 0;
+	int ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "n:T:Y:W:R:L:fsSrpaciCMEtlh")) != -1)
+	{
+		bool ok = true;
+
+		switch (opt)
+		{
+		case 'n':
+			config.nr_workers = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'T':
+			config.nr_tasks = atoi(optarg);
+			break;
+		case 'Y':
+			config.nr_yields = atoi(optarg);
+			break;
+		case 'W':
+			config.work = atoi(optarg);
+			break;
+		case 'R':
+			config.nr_resources = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'L':
+			config.lock_every = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'h':
+			ok = false;
+			break;
+		default:
+			ok = false;
+			for (unsigned int i = 0; i < NR_POLICIES; i++)
+			{
+				if (__policies[i].option == opt && nr_policies < NR_POLICIES)
+				{
+					policies[nr_policies++] = __policies + i;
+					ok = true;
+					break;
+				}
+			}
+			break;
+		}
+
+		if (!ok)
+		{
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!nr_policies)
+	{
+		for (unsigned int i = 0; i < NR_POLICIES; i++)
+			policies[nr_policies++] = __policies + i;
+	}
+
+	printf("# %u %s task%s on %u worker%s, %u yields each\n", config.nr_tasks,
+		   config.lock_every ? "lock-bound" : "CPU-bound", config.nr_tasks == 1 ? "" : "s",
+		   config.nr_workers, config.nr_workers == 1 ? "" : "s", config.nr_yields);
+	printf("%-8s %12s %10s %10s %8s %10s\n",
+		   "policy", "switches", "ns/switch", "blocked", "stolen", "ms");
+
+	for (unsigned int i = 0; i < nr_policies; i++)
+	{
+		if (__bench(policies[i]))
+			ret = EXIT_FAILURE;
+	}
+
+	return ret;
+}
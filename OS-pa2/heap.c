@@ -0,0 +1,89 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "heap.h"
+
+void heap_init(struct heap *heap, bool (*before)(struct process *, struct process *))
+{
+	heap->procs = NULL;
+	heap->nr_procs = 0;
+	heap->capacity = 0;
+	heap->before = before;
+}
+
+void heap_fini(struct heap *heap)
+{
+	free(heap->procs);
+	heap->procs = NULL;
+	heap->nr_procs = heap->capacity = 0;
+}
+
+void heap_push(struct heap *heap, struct process *p)
+{
+	struct process **procs = heap->procs;
+	unsigned int i = heap->nr_procs++;
+
+	if (heap->nr_procs > heap->capacity)
+	{
+		heap->capacity = heap->capacity ? heap->capacity * 2 : 64;
+		procs = heap->procs = realloc(procs, sizeof(*procs) * heap->capacity);
+		assert(procs);
+	}
+
+	/* Sift up */
+	while (i > 0 && heap->before(p, procs[(i - 1) / 2]))
+	{
+		procs[i] = procs[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	procs[i] = p;
+}
+
+struct process *heap_pop(struct heap *heap)
+{
+	struct process **procs = heap->procs;
+	struct process *top, *last;
+	unsigned int i = 0;
+
+	if (!heap->nr_procs)
+		return NULL;
+
+	top = procs[0];
+	last = procs[--heap->nr_procs];
+
+	/* Sift down the last one from the top */
+	while (true)
+	{
+		unsigned int child = 2 * i + 1;
+
+		if (child >= heap->nr_procs)
+			break;
+		if (child + 1 < heap->nr_procs && heap->before(procs[child + 1], procs[child]))
+			child++;
+		if (!heap->before(procs[child], last))
+			break;
+
+		procs[i] = procs[child];
+		i = child;
+	}
+	procs[i] = last;
+
+	return top;
+}
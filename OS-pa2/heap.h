@@ -0,0 +1,71 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+struct process;
+
+/***********************************************************************
+ * struct heap
+ *
+ * DESCRIPTION
+ *   Array-based binary heap of processes. @before(a, b) tells whether
+ *   process a should come out of the heap earlier than b, so the top of the
+ *   heap is the process that comes before all the others.
+ */
+struct heap
+{
+	struct process **procs;
+	unsigned int nr_procs;
+	unsigned int capacity;
+
+	bool (*before)(struct process *, struct process *);
+};
+
+void heap_init(struct heap *heap, bool (*before)(struct process *, struct process *));
+void heap_fini(struct heap *heap);
+
+/***********************************************************************
+ * heap_push()
+ *
+ * DESCRIPTION
+ *   Put @p into @heap in O(log n)
+ */
+void heap_push(struct heap *heap, struct process *p);
+
+/***********************************************************************
+ * heap_pop()
+ *
+ * DESCRIPTION
+ *   Take out the top process of @heap in O(log n)
+ *
+ * RETURN
+ *   The top process
+ *   NULL if @heap is empty
+ */
+struct process *heap_pop(struct heap *heap);
+
+static inline struct process *heap_top(struct heap *heap)
+{
+	return heap->nr_procs ? heap->procs[0] : NULL;
+}
+
+static inline bool heap_empty(struct heap *heap)
+{
+	return heap->nr_procs == 0;
+}
+
+#endif
@@ -0,0 +1,354 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+
+#include "process.h"
+#include "simulation.h"
+#include "metrics.h"
+
+static unsigned int __hist_index(unsigned int value)
+{
+	unsigned int exp;
+
+	if (value < HIST_EXACT)
+		return value;
+
+	exp = 31 - __builtin_clz(value);
+	return HIST_EXACT + (exp - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS +
+		   ((value >> (exp - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+}
+
+/**
+ * The smallest value that falls into the bucket @index
+ */
+static unsigned int __hist_value(unsigned int index)
+{
+	unsigned int exp, sub;
+
+	if (index < HIST_EXACT)
+		return index;
+
+	exp = (index - HIST_EXACT) / HIST_SUB_BUCKETS + HIST_SUB_BITS + 1;
+	sub = (index - HIST_EXACT) % HIST_SUB_BUCKETS;
+	return (HIST_SUB_BUCKETS + sub) << (exp - HIST_SUB_BITS);
+}
+
+static void __hist_add(struct histogram *h, unsigned int value)
+{
+	h->buckets[__hist_index(value)]++;
+	h->nr++;
+	h->sum += value;
+	if (value > h->max)
+		h->max = value;
+}
+
+/**
+ * The nearest-rank percentile. @percent is in [0, 100]
+ */
+static unsigned int __hist_percentile(struct histogram *h, unsigned int percent)
+{
+	unsigned long long rank = (h->nr * percent + 99) / 100;
+	unsigned long long seen = 0;
+
+	if (rank == 0)
+		rank = 1;
+
+	for (unsigned int i = 0; i < NR_HIST_BUCKETS; i++)
+	{
+		seen += h->buckets[i];
+		if (seen >= rank)
+			return __hist_value(i) < h->max ? __hist_value(i) : h->max;
+	}
+	return h->max;
+}
+
+static inline double __hist_mean(struct histogram *h)
+{
+	return h->nr ? (double)h->sum / h->nr : 0.0;
+}
+
+int metrics_init(struct metrics *m)
+{
+	memset(m, 0x00, sizeof(*m));
+
+	m->last_run = calloc(this_sim->nr_cpus, sizeof(*m->last_run));
+	if (!m->last_run)
+		return -1;
+	return 0;
+}
+
+void metrics_fini(struct metrics *m)
+{
+	free(m->last_run);
+	free(m->processes);
+	memset(m, 0x00, sizeof(*m));
+}
+
+void metrics_forked(struct metrics *m, struct process *p)
+{
+	p->__stats.first_run_at = UINT_MAX;
+	p->__stats.woken_at = UINT_MAX;
+	p->__stats.blocked = 0;
+	p->__stats.nr_switches = 0;
+	p->__stats.nr_preempted = 0;
+
+	m->nr_forked++;
+}
+
+void metrics_dispatched(struct metrics *m, unsigned int cpu, struct process *p)
+{
+	if (p->__stats.first_run_at == UINT_MAX)
+		p->__stats.first_run_at = this_sim->ticks;
+
+	/* Woken up and run in the same tick. So, it was not blocked in this tick */
+	if (p->__stats.woken_at == this_sim->ticks)
+	{
+		p->__stats.blocked--;
+		p->__stats.woken_at = UINT_MAX;
+	}
+
+	if (m->last_run[cpu] != p)
+	{
+		m->nr_switches++;
+		p->__stats.nr_switches++;
+		m->last_run[cpu] = p;
+	}
+}
+
+void metrics_preempted(struct metrics *m, struct process *p)
+{
+	m->nr_preemptions++;
+	p->__stats.nr_preempted++;
+}
+
+void metrics_ran(struct metrics *m, unsigned int nr_ticks)
+{
+	m->busy_ticks += nr_ticks;
+}
+
+void metrics_blocked(struct metrics *m, struct process *p)
+{
+	p->__stats.blocked_at = this_sim->ticks;
+}
+
+void metrics_woken(struct metrics *m, struct process *p)
+{
+	p->__stats.blocked += this_sim->ticks + 1 - p->__stats.blocked_at;
+	p->__stats.woken_at = this_sim->ticks;
+}
+
+void metrics_exited(struct metrics *m, struct process *p)
+{
+	struct process_metrics *pm;
+	unsigned int turnaround = this_sim->ticks - p->__starts_at;
+
+	if (m->nr_processes == m->capacity)
+	{
+		m->capacity = m->capacity ? m->capacity * 2 : 64;
+		m->processes = realloc(m->processes, sizeof(*m->processes) * m->capacity);
+		assert(m->processes);
+	}
+
+	pm = m->processes + m->nr_processes++;
+	pm->pid = p->pid;
+	pm->prio = p->prio_orig;
+	pm->starts_at = p->__starts_at;
+	pm->first_run_at = p->__stats.first_run_at;
+	pm->exits_at = this_sim->ticks;
+	pm->lifespan = p->lifespan;
+	pm->blocked = p->__stats.blocked;
+	pm->nr_switches = p->__stats.nr_switches;
+	pm->nr_preempted = p->__stats.nr_preempted;
+	pm->deadline = p->deadline;
+
+	__hist_add(&m->turnaround, turnaround);
+	__hist_add(&m->waiting, turnaround - p->lifespan - p->__stats.blocked);
+	__hist_add(&m->response, p->__stats.first_run_at - p->__starts_at);
+	__hist_add(&m->blocked, p->__stats.blocked);
+
+	if (p->deadline != UINT_MAX)
+	{
+		if (this_sim->ticks > p->deadline)
+			m->nr_missed++;
+		__hist_add(&m->tardiness, this_sim->ticks > p->deadline
+									  ? this_sim->ticks - p->deadline
+									  : 0);
+	}
+
+	/* Do not take a new process at the same address for this one */
+	for (unsigned int i = 0; i < this_sim->nr_cpus; i++)
+	{
+		if (m->last_run[i] == p)
+			m->last_run[i] = NULL;
+	}
+}
+
+static const char *__hist_names[] = {
+	"turnaround",
+	"waiting",
+	"response",
+	"blocked",
+};
+
+static inline unsigned int __tardiness(struct process_metrics *pm)
+{
+	return pm->exits_at > pm->deadline ? pm->exits_at - pm->deadline : 0;
+}
+
+static void __report_csv(struct metrics *m, FILE *stream, const char *policy)
+{
+	struct histogram *hists[] = {&m->turnaround, &m->waiting, &m->response, &m->blocked};
+	unsigned int ticks = this_sim->ticks;
+	double utilization = ticks ? (double)m->busy_ticks / ticks / this_sim->nr_cpus : 0.0;
+
+	fprintf(stream, "scope,metric,value\n");
+	fprintf(stream, "all,policy,\"%s\"\n", policy);
+	fprintf(stream, "all,ticks,%u\n", ticks);
+	fprintf(stream, "all,cpus,%u\n", this_sim->nr_cpus);
+	fprintf(stream, "all,utilization,%.4f\n", utilization);
+	fprintf(stream, "all,forked,%u\n", m->nr_forked);
+	fprintf(stream, "all,finished,%u\n", m->nr_processes);
+	fprintf(stream, "all,context_switches,%llu\n", m->nr_switches);
+	fprintf(stream, "all,preemptions,%llu\n", m->nr_preemptions);
+
+	for (int i = 0; i < sizeof(hists) / sizeof(hists[0]); i++)
+	{
+		fprintf(stream, "all,%s_mean,%.4f\n", __hist_names[i], __hist_mean(hists[i]));
+		fprintf(stream, "all,%s_p50,%u\n", __hist_names[i], __hist_percentile(hists[i], 50));
+		fprintf(stream, "all,%s_p95,%u\n", __hist_names[i], __hist_percentile(hists[i], 95));
+		fprintf(stream, "all,%s_p99,%u\n", __hist_names[i], __hist_percentile(hists[i], 99));
+		fprintf(stream, "all,%s_max,%u\n", __hist_names[i], hists[i]->max);
+	}
+
+	if (this_sim->deadlines.nr_processes)
+	{
+		struct histogram *h = &m->tardiness;
+
+		fprintf(stream, "all,deadlines,%u\n", this_sim->deadlines.nr_processes);
+		fprintf(stream, "all,deadline_misses,%u\n", m->nr_missed);
+		fprintf(stream, "all,peak_density,%.4f\n", this_sim->deadlines.density);
+		fprintf(stream, "all,schedulable,%s\n",
+				this_sim->deadlines.schedulable ? "true" : "false");
+		fprintf(stream, "all,tardiness_mean,%.4f\n", __hist_mean(h));
+		fprintf(stream, "all,tardiness_p50,%u\n", __hist_percentile(h, 50));
+		fprintf(stream, "all,tardiness_p95,%u\n", __hist_percentile(h, 95));
+		fprintf(stream, "all,tardiness_p99,%u\n", __hist_percentile(h, 99));
+		fprintf(stream, "all,tardiness_max,%u\n", h->max);
+	}
+
+	for (unsigned int i = 0; i < m->nr_processes; i++)
+	{
+		struct process_metrics *pm = m->processes + i;
+		unsigned int turnaround = pm->exits_at - pm->starts_at;
+
+		fprintf(stream, "%u,prio,%u\n", pm->pid, pm->prio);
+		fprintf(stream, "%u,start,%u\n", pm->pid, pm->starts_at);
+		fprintf(stream, "%u,first_run,%u\n", pm->pid, pm->first_run_at);
+		fprintf(stream, "%u,exit,%u\n", pm->pid, pm->exits_at);
+		fprintf(stream, "%u,lifespan,%u\n", pm->pid, pm->lifespan);
+		fprintf(stream, "%u,turnaround,%u\n", pm->pid, turnaround);
+		fprintf(stream, "%u,waiting,%u\n", pm->pid, turnaround - pm->lifespan - pm->blocked);
+		fprintf(stream, "%u,response,%u\n", pm->pid, pm->first_run_at - pm->starts_at);
+		fprintf(stream, "%u,blocked,%u\n", pm->pid, pm->blocked);
+		fprintf(stream, "%u,context_switches,%u\n", pm->pid, pm->nr_switches);
+		fprintf(stream, "%u,preemptions,%u\n", pm->pid, pm->nr_preempted);
+		if (pm->deadline != UINT_MAX)
+		{
+			fprintf(stream, "%u,deadline,%u\n", pm->pid, pm->deadline);
+			fprintf(stream, "%u,tardiness,%u\n", pm->pid, __tardiness(pm));
+		}
+	}
+}
+
+static void __report_json(struct metrics *m, FILE *stream, const char *policy)
+{
+	struct histogram *hists[] = {&m->turnaround, &m->waiting, &m->response, &m->blocked};
+	unsigned int ticks = this_sim->ticks;
+	double utilization = ticks ? (double)m->busy_ticks / ticks / this_sim->nr_cpus : 0.0;
+
+	fprintf(stream, "{\n");
+	fprintf(stream, "  \"policy\": \"%s\",\n", policy);
+	fprintf(stream, "  \"ticks\": %u,\n", ticks);
+	fprintf(stream, "  \"cpus\": %u,\n", this_sim->nr_cpus);
+	fprintf(stream, "  \"utilization\": %.4f,\n", utilization);
+	fprintf(stream, "  \"forked\": %u,\n", m->nr_forked);
+	fprintf(stream, "  \"finished\": %u,\n", m->nr_processes);
+	fprintf(stream, "  \"context_switches\": %llu,\n", m->nr_switches);
+	fprintf(stream, "  \"preemptions\": %llu,\n", m->nr_preemptions);
+
+	for (int i = 0; i < sizeof(hists) / sizeof(hists[0]); i++)
+	{
+		fprintf(stream, "  \"%s\": {\"mean\": %.4f, \"p50\": %u, \"p95\": %u, \"p99\": %u, \"max\": %u},\n",
+				__hist_names[i], __hist_mean(hists[i]),
+				__hist_percentile(hists[i], 50), __hist_percentile(hists[i], 95),
+				__hist_percentile(hists[i], 99), hists[i]->max);
+	}
+
+	if (this_sim->deadlines.nr_processes)
+	{
+		struct histogram *h = &m->tardiness;
+
+		fprintf(stream, "  \"deadlines\": {\"processes\": %u, \"misses\": %u, "
+						"\"peak_density\": %.4f, \"schedulable\": %s, "
+						"\"tardiness\": {\"mean\": %.4f, \"p50\": %u, \"p95\": %u, "
+						"\"p99\": %u, \"max\": %u}},\n",
+				this_sim->deadlines.nr_processes, m->nr_missed,
+				this_sim->deadlines.density,
+				this_sim->deadlines.schedulable ? "true" : "false",
+				__hist_mean(h), __hist_percentile(h, 50), __hist_percentile(h, 95),
+				__hist_percentile(h, 99), h->max);
+	}
+
+	fprintf(stream, "  \"processes\": [");
+	for (unsigned int i = 0; i < m->nr_processes; i++)
+	{
+		struct process_metrics *pm = m->processes + i;
+		unsigned int turnaround = pm->exits_at - pm->starts_at;
+
+		fprintf(stream, "%s\n    {\"pid\": %u, \"prio\": %u, \"start\": %u, \"first_run\": %u, "
+						"\"exit\": %u, \"lifespan\": %u, \"turnaround\": %u, \"waiting\": %u, "
+						"\"response\": %u, \"blocked\": %u, \"context_switches\": %u, "
+						"\"preemptions\": %u",
+				i ? "," : "", pm->pid, pm->prio, pm->starts_at, pm->first_run_at,
+				pm->exits_at, pm->lifespan, turnaround, turnaround - pm->lifespan - pm->blocked,
+				pm->first_run_at - pm->starts_at, pm->blocked, pm->nr_switches,
+				pm->nr_preempted);
+		if (pm->deadline != UINT_MAX)
+		{
+			fprintf(stream, ", \"deadline\": %u, \"tardiness\": %u",
+					pm->deadline, __tardiness(pm));
+		}
+		fprintf(stream, "}");
+	}
+	fprintf(stream, "%s]\n}\n", m->nr_processes ? "\n  " : "");
+}
+
+void metrics_report(struct metrics *m, FILE *stream, enum metrics_format format,
+					const char *policy)
+{
+	if (format == METRICS_JSON)
+		__report_json(m, stream, policy);
+	else
+		__report_csv(m, stream, policy);
+}
@@ -0,0 +1,132 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdio.h>
+
+struct process;
+
+/**
+ * Histogram of tick counts. Values below HIST_EXACT are counted exactly,
+ * and larger ones are counted in HIST_SUB_BUCKETS buckets for each power of
+ * two, so a percentile is off by 1/HIST_SUB_BUCKETS at most.
+ */
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_EXACT (HIST_SUB_BUCKETS * 2)
+#define NR_HIST_BUCKETS (HIST_EXACT + (32 - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS)
+
+struct histogram
+{
+	unsigned long long buckets[NR_HIST_BUCKETS];
+	unsigned long long nr;
+	unsigned long long sum;
+	unsigned int max;
+};
+
+/**
+ * What is left of an exited process
+ */
+struct process_metrics
+{
+	unsigned int pid;
+	unsigned int prio;
+	unsigned int starts_at;
+	unsigned int first_run_at;
+	unsigned int exits_at;
+	unsigned int lifespan;
+	unsigned int blocked;
+	unsigned int nr_switches;
+	unsigned int nr_preempted;
+	unsigned int deadline; /* UINT_MAX if none */
+};
+
+/***********************************************************************
+ * struct metrics
+ *
+ * DESCRIPTION
+ *   Scheduling metrics of a simulation, updated as the simulation goes.
+ *   For each process,
+ *
+ *   - turnaround: from the fork to the exit
+ *   - response: from the fork to the first time it gets a CPU
+ *   - blocked: # of ticks it waits for resources
+ *   - waiting: # of ticks it is ready but not running. That is, turnaround
+ *              - lifespan - blocked
+ *
+ *   and they are summarized into histograms. A process with a deadline
+ *   misses it when it exits after the deadline, and its tardiness is how
+ *   late it exits (0 if it meets the deadline). Besides, # of context switches
+ *   (a CPU runs a process other than the one ran on it last time),
+ *   preemptions (a runnable process is switched out), and the ticks that
+ *   CPUs make progress are counted.
+ */
+struct metrics
+{
+	struct histogram turnaround;
+	struct histogram waiting;
+	struct histogram response;
+	struct histogram blocked;
+	struct histogram tardiness;
+
+	unsigned long long nr_switches;
+	unsigned long long nr_preemptions;
+	unsigned long long busy_ticks;
+	unsigned int nr_forked;
+	unsigned int nr_missed;
+
+	struct process **last_run; /* The process ran last time on each CPU */
+
+	struct process_metrics *processes;
+	unsigned int nr_processes;
+	unsigned int capacity;
+};
+
+enum metrics_format
+{
+	METRICS_CSV,
+	METRICS_JSON,
+};
+
+/**
+ * Initialize @m for the CPUs and resources of @this_sim
+ */
+int metrics_init(struct metrics *m);
+void metrics_fini(struct metrics *m);
+
+/**
+ * Hooks for the framework. See sched.c
+ */
+void metrics_forked(struct metrics *m, struct process *p);
+void metrics_dispatched(struct metrics *m, unsigned int cpu, struct process *p);
+void metrics_preempted(struct metrics *m, struct process *p);
+void metrics_ran(struct metrics *m, unsigned int nr_ticks);
+void metrics_blocked(struct metrics *m, struct process *p);
+void metrics_woken(struct metrics *m, struct process *p);
+void metrics_exited(struct metrics *m, struct process *p);
+
+/***********************************************************************
+ * metrics_report()
+ *
+ * DESCRIPTION
+ *   Write the metrics of @this_sim, which has run with @policy, in @format
+ *   into @stream.
+ */
+void metrics_report(struct metrics *m, FILE *stream, enum metrics_format format,
+					const char *policy);
+
+#endif
@@ -0,0 +1,92 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "script.h"
+
+/***********************************************************************
+ * mkscript
+ *
+ * DESCRIPTION
+ *   Convert a process script into the binary format that sched maps into
+ *   the memory, or back into the text format with -t. The input can be in
+ *   either format.
+ */
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-t} [input script file] [output script file]\n", name);
+	printf("\n");
+	printf("  -t: Write the script in the text format instead of the binary one\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	bool text = false;
+	struct script script;
+	FILE *output;
+	int ret = EXIT_FAILURE;
+
+	while ((opt = getopt(argc, argv, "th")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			text = true;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 2 != argc)
+	{
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (script_load(&script, argv[optind]))
+		return EXIT_FAILURE;
+
+	output = fopen(argv[optind + 1], text ? "w" : "wb");
+	if (!output)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[optind + 1]);
+		goto out;
+	}
+
+	if (text ? script_write_text(&script, output) : script_write_binary(&script, output))
+	{
+		fprintf(stderr, "Cannot write %s\n", argv[optind + 1]);
+		fclose(output);
+		goto out;
+	}
+
+	if (fclose(output) == 0)
+		ret = EXIT_SUCCESS;
+out:
+	script_unload(&script);
+	return ret;
+}
@@ -0,0 +1,620 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "resource.h"
+#include "script.h"
+
+/***********************************************************************
+ * mkworkload
+ *
+ * DESCRIPTION
+ *   Generate a process script to stress the schedulers. Processes arrive
+ *   in a Poisson process or in bursts, live for exponentially, Pareto, or
+ *   bimodally distributed ticks, get priorities from the given mix, and
+ *   acquire resources chosen uniformly or skewed toward hot ones.
+ *
+ *   The same options and seed make the same script. The seed is recorded
+ *   in the script, so a script can be reproduced from itself.
+ */
+
+/* Lifespans are clamped to keep heavy tails within the tick counter */
+#define MAX_LIFESPAN (1U << 24)
+
+enum arrival
+{
+	ARRIVAL_POISSON,
+	ARRIVAL_BURSTY,
+};
+
+enum lifespan
+{
+	LIFESPAN_EXP,
+	LIFESPAN_PARETO,
+	LIFESPAN_BIMODAL,
+};
+
+struct prio_mix
+{
+	unsigned int prio;
+	double weight; /* Accumulated weight up to this entry */
+};
+
+static struct
+{
+	unsigned int nr_processes;
+	unsigned long long seed;
+
+	enum arrival arrival;
+	double rate;	   /* Mean # of processes arriving per tick */
+	double burst_size; /* Mean # of processes in a burst */
+
+	enum lifespan lifespan;
+	double lifespan_args[3];
+
+	struct prio_mix *prios;
+	unsigned int nr_prios;
+
+	unsigned int nr_resources;
+	double contention;		 /* Probability of a process to acquire resources */
+	unsigned int nr_acquires; /* Max # of acquisitions of a process */
+	double skew;			 /* Zipf exponent to choose resources */
+	bool nested;
+	double shared;			 /* Probability of an acquisition to be shared */
+	double *hotness;		 /* Accumulated Zipf weights of resources */
+
+	bool text;
+} config = {
+	.nr_processes = 1000,
+	.arrival = ARRIVAL_POISSON,
+	.rate = 0.08,
+	.burst_size = 8,
+	.lifespan = LIFESPAN_EXP,
+	.lifespan_args = {10},
+	.nr_resources = 4,
+	.contention = 0,
+	.nr_acquires = 1,
+	.skew = 0,
+};
+
+/**
+ * xoshiro256** seeded with splitmix64, so scripts are the same anywhere
+ */
+static uint64_t __rng[4];
+
+static inline uint64_t __rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static void __seed(unsigned long long seed)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		__rng[i] = z ^ (z >> 31);
+	}
+}
+
+static uint64_t __random(void)
+{
+	uint64_t result = __rotl(__rng[1] * 5, 7) * 9;
+	uint64_t t = __rng[1] << 17;
+
+	__rng[2] ^= __rng[0];
+	__rng[3] ^= __rng[1];
+	__rng[1] ^= __rng[2];
+	__rng[0] ^= __rng[3];
+	__rng[2] ^= t;
+	__rng[3] = __rotl(__rng[3], 45);
+
+	return result;
+}
+
+/**
+ * Uniform in [0, 1)
+ */
+static inline double __uniform(void)
+{
+	return (__random() >> 11) * 0x1.0p-53;
+}
+
+/**
+ * Uniform in [0, n)
+ */
+static inline unsigned int __below(unsigned int n)
+{
+	return (unsigned int)(__uniform() * n);
+}
+
+static inline double __exponential(double mean)
+{
+	return -mean * log(1.0 - __uniform());
+}
+
+static unsigned int __pick_lifespan(void)
+{
+	double *args = config.lifespan_args;
+	double lifespan;
+
+	switch (config.lifespan)
+	{
+	case LIFESPAN_PARETO:
+		lifespan = args[1] / pow(1.0 - __uniform(), 1.0 / args[0]);
+		break;
+	case LIFESPAN_BIMODAL:
+		lifespan = __exponential(__uniform() < args[2] ? args[1] : args[0]);
+		break;
+	case LIFESPAN_EXP:
+	default:
+		lifespan = __exponential(args[0]);
+		break;
+	}
+
+	if (lifespan < 1)
+		return 1;
+	if (lifespan > MAX_LIFESPAN)
+		return MAX_LIFESPAN;
+	return (unsigned int)lifespan;
+}
+
+static unsigned int __pick_prio(void)
+{
+	double w = __uniform() * config.prios[config.nr_prios - 1].weight;
+	unsigned int l = 0, r = config.nr_prios - 1;
+
+	while (l < r)
+	{
+		unsigned int m = (l + r) / 2;
+		if (config.prios[m].weight > w)
+			r = m;
+		else
+			l = m + 1;
+	}
+	return config.prios[l].prio;
+}
+
+static int __pick_resource(void)
+{
+	double w = __uniform() * config.hotness[config.nr_resources - 1];
+	unsigned int l = 0, r = config.nr_resources - 1;
+
+	while (l < r)
+	{
+		unsigned int m = (l + r) / 2;
+		if (config.hotness[m] > w)
+			r = m;
+		else
+			l = m + 1;
+	}
+	return l;
+}
+
+/***********************************************************************
+ * __make_acquires()
+ *
+ * DESCRIPTION
+ *   Make @nr acquisitions into @a for a process living @lifespan ticks.
+ *   The acquisitions are made one after another in distinct slices of the
+ *   lifespan, or nested in the increasing order of the resource ids if
+ *   config.nested is set. Either way, processes never deadlock and they
+ *   release all resources before exiting. Each acquisition is shared with
+ *   the probability of config.shared.
+ */
+static void __make_acquires(struct script_acquire *a, unsigned int nr, unsigned int lifespan)
+{
+	if (!config.nested)
+	{
+		for (unsigned int i = 0; i < nr; i++)
+		{
+			unsigned int from = lifespan * i / nr;
+			unsigned int to = lifespan * (i + 1) / nr;
+
+			a[i].resource_id = __pick_resource();
+			a[i].at = from + __below(to - from);
+			a[i].duration = 1 + __below(to - a[i].at);
+		}
+		goto out_mode;
+	}
+
+	/* Pick distinct resources and sort them */
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		bool picked;
+		int id;
+		do
+		{
+			id = __pick_resource();
+			picked = false;
+			for (unsigned int j = 0; j < i; j++)
+				picked |= a[j].resource_id == id;
+		} while (picked);
+
+		unsigned int j = i;
+		for (; j > 0 && a[j - 1].resource_id > id; j--)
+			a[j].resource_id = a[j - 1].resource_id;
+		a[j].resource_id = id;
+	}
+
+	/* Nest the holding periods [at, at + duration) */
+	unsigned int from = 0, to = lifespan;
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		a[i].at = from + __below(to - from);
+		to = a[i].at + 1 + __below(to - a[i].at);
+		a[i].duration = to - a[i].at;
+		from = a[i].at;
+	}
+
+out_mode:
+	/* Draw the modes only if asked, so the other scripts stay the same */
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		a[i].mode = config.shared > 0 && __uniform() < config.shared
+						? RESOURCE_SHARED
+						: RESOURCE_EXCLUSIVE;
+	}
+}
+
+/***********************************************************************
+ * __generate()
+ *
+ * DESCRIPTION
+ *   Generate the processes into @s.
+ */
+static void __generate(struct script *s)
+{
+	struct script_process *processes;
+	struct script_acquire *acquires = NULL;
+	unsigned int nr_acquires = 0, max_acquires = 0;
+	double now = 0;
+	unsigned int burst = 0;
+
+	memset(s, 0x00, sizeof(*s));
+	processes = malloc(sizeof(*processes) * (config.nr_processes ? config.nr_processes : 1));
+	assert(processes);
+
+	for (unsigned int i = 0; i < config.nr_processes; i++)
+	{
+		struct script_process *p = processes + i;
+
+		if (config.arrival == ARRIVAL_BURSTY)
+		{
+			/**
+			 * A burst of geometrically many processes arrives at once, and
+			 * bursts are apart to keep the mean rate
+			 */
+			if (burst == 0)
+			{
+				now += __exponential(config.burst_size / config.rate);
+				burst = 1 + (unsigned int)floor(log(1.0 - __uniform()) /
+												log(1.0 - 1.0 / config.burst_size));
+			}
+			burst--;
+		}
+		else
+		{
+			now += __exponential(1.0 / config.rate);
+		}
+		assert(now < UINT32_MAX && "Too many processes for the arrival rate");
+
+		p->pid = i + 1;
+		p->starts_at = (unsigned int)now;
+		p->lifespan = __pick_lifespan();
+		p->prio = __pick_prio();
+		p->acquires = nr_acquires;
+		p->nr_acquires = 0;
+		p->period = 0;
+		p->deadline = 0;
+
+		if (config.nr_resources && __uniform() < config.contention)
+		{
+			unsigned int nr = 1 + __below(config.nr_acquires);
+
+			if (nr > p->lifespan && !config.nested)
+				nr = p->lifespan;
+
+			if (nr_acquires + nr > max_acquires)
+			{
+				max_acquires = max_acquires ? max_acquires * 2 : 1024;
+				acquires = realloc(acquires, sizeof(*acquires) * max_acquires);
+				assert(acquires);
+			}
+			__make_acquires(acquires + nr_acquires, nr, p->lifespan);
+			p->nr_acquires = nr;
+			nr_acquires += nr;
+		}
+	}
+
+	s->processes = processes;
+	s->nr_processes = config.nr_processes;
+	s->acquires = acquires;
+	s->nr_acquires = nr_acquires;
+	s->max_resource_id = -1;
+	for (unsigned int i = 0; i < nr_acquires; i++)
+	{
+		if (acquires[i].resource_id > s->max_resource_id)
+			s->max_resource_id = acquires[i].resource_id;
+	}
+	s->seeded = true;
+	s->seed = config.seed;
+	s->map = NULL;
+}
+
+/**
+ * Parse up to @max numbers separated by ':' after @prefix in @arg
+ */
+static int __parse_args(const char *arg, const char *prefix, double *args, int max)
+{
+	size_t len = strlen(prefix);
+	char *end;
+	int nr = 0;
+
+	if (strncmp(arg, prefix, len) != 0)
+		return -1;
+	arg += len;
+
+	while (*arg == ':' && nr < max)
+	{
+		args[nr++] = strtod(arg + 1, &end);
+		if (end == arg + 1)
+			return -1;
+		arg = end;
+	}
+	return *arg == '\0' ? nr : -1;
+}
+
+static int __parse_lifespan(const char *arg)
+{
+	double *args = config.lifespan_args;
+
+	if (__parse_args(arg, "exp", args, 1) == 1 && args[0] > 0)
+	{
+		config.lifespan = LIFESPAN_EXP;
+	}
+	else if (__parse_args(arg, "pareto", args, 2) == 2 && args[0] > 0 && args[1] > 0)
+	{
+		config.lifespan = LIFESPAN_PARETO;
+	}
+	else if (__parse_args(arg, "bimodal", args, 3) == 3 && args[0] > 0 && args[1] > 0 &&
+			 args[2] >= 0 && args[2] <= 1)
+	{
+		config.lifespan = LIFESPAN_BIMODAL;
+	}
+	else
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Parse "prio:weight,prio:weight,..."
+ */
+static int __parse_prios(const char *arg)
+{
+	double weight = 0;
+	unsigned int max = 0;
+
+	config.nr_prios = 0;
+	while (*arg)
+	{
+		char *end;
+		long prio = strtol(arg, &end, 10);
+		double w;
+
+		if (end == arg || *end != ':' || prio < 0)
+			return -1;
+		arg = end + 1;
+		w = strtod(arg, &end);
+		if (end == arg || w < 0)
+			return -1;
+		arg = end;
+		if (*arg == ',')
+			arg++;
+		else if (*arg)
+			return -1;
+
+		if (config.nr_prios == max)
+		{
+			max = max ? max * 2 : 8;
+			config.prios = realloc(config.prios, sizeof(*config.prios) * max);
+			assert(config.prios);
+		}
+		weight += w;
+		config.prios[config.nr_prios].prio = prio;
+		config.prios[config.nr_prios].weight = weight;
+		config.nr_prios++;
+	}
+	return weight > 0 ? 0 : -1;
+}
+
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {options} [output script file]\n", name);
+	printf("\n");
+	printf("  -n: Generate @n processes (1000 by default)\n");
+	printf("  -s: Use @seed for the random numbers (by the time by default)\n");
+	printf("  -a: Processes arrive in a poisson process or in bursty way\n");
+	printf("  -r: @rate processes arrive per tick on average (0.08 by default)\n");
+	printf("  -b: @size processes arrive in a burst on average for -a bursty (8 by default)\n");
+	printf("  -l: Lifespan distribution. One of\n");
+	printf("        exp:@mean (exp:10 by default)\n");
+	printf("        pareto:@alpha:@min\n");
+	printf("        bimodal:@short:@long:@probability-of-long\n");
+	printf("  -p: Priority mix as @prio:@weight,... (0:1 by default)\n");
+	printf("  -R: Use @resources resources (4 by default)\n");
+	printf("  -c: Processes acquire resources with @probability (0 by default)\n");
+	printf("  -k: A process acquires up to @k resources (1 by default)\n");
+	printf("  -z: Choose resources in Zipf distribution with @skew (0, uniform, by default)\n");
+	printf("  -w: Acquire resources in the shared mode with @probability (0 by default)\n");
+	printf("  -N: Nest the acquisitions rather than making them one by one\n");
+	printf("  -t: Write the script in the text format instead of the binary one\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	struct script script;
+	FILE *output;
+	int ret = EXIT_FAILURE;
+
+	config.seed = (unsigned long long)time(NULL) ^ ((unsigned long long)getpid() << 32);
+
+	while ((opt = getopt(argc, argv, "n:s:a:r:b:l:p:R:c:k:z:w:Nth")) != -1)
+	{
+		bool ok = true;
+
+		switch (opt)
+		{
+		case 'n':
+			config.nr_processes = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			config.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'a':
+			if (strcmp(optarg, "poisson") == 0)
+				config.arrival = ARRIVAL_POISSON;
+			else if (strcmp(optarg, "bursty") == 0)
+				config.arrival = ARRIVAL_BURSTY;
+			else
+				ok = false;
+			break;
+		case 'r':
+			config.rate = strtod(optarg, NULL);
+			ok = config.rate > 0;
+			break;
+		case 'b':
+			config.burst_size = strtod(optarg, NULL);
+			ok = config.burst_size >= 1;
+			break;
+		case 'l':
+			ok = __parse_lifespan(optarg) == 0;
+			break;
+		case 'p':
+			ok = __parse_prios(optarg) == 0;
+			break;
+		case 'R':
+			config.nr_resources = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			config.contention = strtod(optarg, NULL);
+			ok = config.contention >= 0 && config.contention <= 1;
+			break;
+		case 'k':
+			config.nr_acquires = strtoul(optarg, NULL, 10);
+			ok = config.nr_acquires >= 1;
+			break;
+		case 'z':
+			config.skew = strtod(optarg, NULL);
+			ok = config.skew >= 0;
+			break;
+		case 'w':
+			config.shared = strtod(optarg, NULL);
+			ok = config.shared >= 0 && config.shared <= 1;
+			break;
+		case 'N':
+			config.nested = true;
+			break;
+		case 't':
+			config.text = true;
+			break;
+		case 'h':
+		default:
+			ok = false;
+			break;
+		}
+
+		if (!ok)
+		{
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc)
+	{
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!config.prios && __parse_prios("0:1"))
+		return EXIT_FAILURE;
+
+	if (config.nested && config.nr_acquires > config.nr_resources)
+	{
+		fprintf(stderr, "Cannot nest %u acquisitions over %u resources\n",
+				config.nr_acquires, config.nr_resources);
+		return EXIT_FAILURE;
+	}
+
+	if (config.nr_resources)
+	{
+		config.hotness = malloc(sizeof(*config.hotness) * config.nr_resources);
+		assert(config.hotness);
+		for (unsigned int i = 0; i < config.nr_resources; i++)
+		{
+			config.hotness[i] = (i ? config.hotness[i - 1] : 0) + pow(i + 1, -config.skew);
+		}
+	}
+
+	__seed(config.seed);
+	__generate(&script);
+
+	output = fopen(argv[optind], config.text ? "w" : "wb");
+	if (!output)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		goto out;
+	}
+
+	if (config.text)
+	{
+		fprintf(output, "#");
+		for (int i = 0; i < argc - 1; i++)
+			fprintf(output, " %s", argv[i]);
+		fprintf(output, "\n");
+	}
+
+	if (config.text ? script_write_text(&script, output) : script_write_binary(&script, output))
+	{
+		fprintf(stderr, "Cannot write %s\n", argv[optind]);
+		fclose(output);
+		goto out;
+	}
+
+	if (fclose(output) == 0)
+		ret = EXIT_SUCCESS;
+out:
+	script_unload(&script);
+	free(config.hotness);
+	free(config.prios);
+	return ret;
+}
@@ -21,65 +21,172 @@
 
 #include "types.h"
 #include "list_head.h"
-#define MAX_LIFESPAN (int)99999999999
-/**
- * The process which is currently running
- */
+#include "rbtree.h"
+
 #include "process.h"
-extern struct process *current;
+#include "resource.h"
+#include "runqueue.h"
+#include "heap.h"
+#include "cpu.h"
 
 /**
- * List head to hold the processes ready to run
+ * The simulator state such as @current, @readyqueue, @resources, @ticks, and
+ * @quiet. They refer to those of the simulation that this thread is running.
+ * See pa2sim.h
  */
-extern struct list_head readyqueue;
+#include "pa2sim.h"
+
+/***********************************************************************
+ * Resource holding
+ *
+ * DESCRIPTION
+ *   A resource is held by readers in RESOURCE_SHARED or by up to @units
+ *   writers in RESOURCE_EXCLUSIVE, so a mutex is a resource of one unit that
+ *   is always acquired exclusively. Once a writer waits, only @batch more
+ *   readers get in ahead of it so that writers are not starved.
+ *
+ *   On a release, the policies wake up every waiter that can take the
+ *   resource together in their order; a batch of readers, or as many
+ *   writers as the free units. The woken ones acquire it again when they
+ *   are scheduled as before. See struct resource in resource.h
+ ***********************************************************************/
+static inline bool __resource_available(struct resource *r, enum resource_mode mode,
+										unsigned int nr_shared, unsigned int nr_exclusive,
+										unsigned int nr_batched)
+{
+	if (mode == RESOURCE_SHARED)
+		return !nr_exclusive && (!r->nr_writers || nr_batched < r->batch);
+
+	return !nr_shared && nr_exclusive < r->units;
+}
+
+static inline bool resource_available(struct resource *r, enum resource_mode mode)
+{
+	return __resource_available(r, mode, r->nr_shared, r->nr_exclusive, r->nr_batched);
+}
 
 /**
- * Resources in the system.
+ * Let @current hold @r in @mode. @current becomes the owner of a mutex
  */
-#include "resource.h"
-extern struct resource resources[NR_RESOURCES];
+static void resource_take(struct resource *r, enum resource_mode mode)
+{
+	if (mode == RESOURCE_SHARED)
+	{
+		r->nr_shared++;
+		if (r->nr_writers)
+			r->nr_batched++;
+		return;
+	}
+
+	r->nr_exclusive++;
+	r->nr_batched = 0;
+	if (r->units == 1)
+		r->owner = current;
+}
 
 /**
- * Monotonically increasing ticks
+ * Let @current go of @r, in whichever mode it holds @r
  */
-extern unsigned int ticks;
+static void resource_put(struct resource *r)
+{
+	if (r->nr_shared)
+	{
+		r->nr_shared--;
+		return;
+	}
+
+	/* Ensure that the owner process is releasing the resource */
+	assert(r->nr_exclusive && (r->units > 1 || r->owner == current));
+
+	r->nr_exclusive--;
+	r->owner = NULL;
+}
 
 /**
- * Quiet mode. True if the program was started with -q option
+ * Put @current into the wait status for @r in @mode. The caller queues it
  */
-extern bool quiet;
+static void resource_wait(struct resource *r, enum resource_mode mode)
+{
+	current->status = PROCESS_WAIT;
+	current->waiting_for = r;
+	current->wait_mode = mode;
+	if (mode == RESOURCE_EXCLUSIVE)
+		r->nr_writers++;
+}
 
-struct resource_schedule
+/**
+ * The holders of a resource counting in the waiters woken up so far
+ */
+struct resource_wakeup
 {
-	int resource_id;
-	int at;
-	int duration;
-	struct list_head list;
+	unsigned int nr_shared;
+	unsigned int nr_exclusive;
+	unsigned int nr_batched;
 };
+
+static inline void resource_wakeup_init(struct resource_wakeup *w, struct resource *r)
+{
+	w->nr_shared = r->nr_shared;
+	w->nr_exclusive = r->nr_exclusive;
+	w->nr_batched = r->nr_batched;
+}
+
+/**
+ * Tell whether no more waiter can be woken up for @r
+ */
+static inline bool resource_wakeup_done(struct resource_wakeup *w, struct resource *r)
+{
+	return !__resource_available(r, RESOURCE_SHARED, w->nr_shared, w->nr_exclusive, w->nr_batched) &&
+		   !__resource_available(r, RESOURCE_EXCLUSIVE, w->nr_shared, w->nr_exclusive, w->nr_batched);
+}
+
+/**
+ * Count in @p waiting for @r if it can be woken up along with the others
+ */
+static bool resource_wakeup(struct resource_wakeup *w, struct resource *r, struct process *p)
+{
+	if (!__resource_available(r, p->wait_mode, w->nr_shared, w->nr_exclusive, w->nr_batched))
+		return false;
+
+	if (p->wait_mode == RESOURCE_SHARED)
+	{
+		w->nr_shared++;
+		if (r->nr_writers)
+			w->nr_batched++;
+	}
+	else
+	{
+		w->nr_exclusive++;
+		r->nr_writers--;
+	}
+	p->waiting_for = NULL;
+	return true;
+}
+
 /***********************************************************************
  * Default FCFS resource acquision function
  *
  * DESCRIPTION
  *   This is the default resource acquision function which is called back
- *   whenever the current process is to acquire resource @resource_id.
- *   The current implementation serves the resource in the requesting order
+ *   whenever the current process is to acquire resource @resource_id in
+ *   @mode. The current implementation serves the resource in the requesting order
  *   without considering the priority. See the comments in sched.h
  ***********************************************************************/
-bool fcfs_acquire(int resource_id)
+bool fcfs_acquire(int resource_id, enum resource_mode mode)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner)
+	if (resource_available(r, mode))
 	{
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+		/* This resource is not owned by any one in the way. Take it! */
+		resource_take(r, mode);
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	/* OK, this resource is taken by others. */
 
 	/* Update the current process state */
-	current->status = PROCESS_WAIT;
+	resource_wait(r, mode);
 
 	/* And append current to waitqueue */
 	list_add_tail(&current->list, &r->waitqueue);
@@ -104,17 +211,20 @@ bool fcfs_acquire(int resource_id)
 void fcfs_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	struct resource_wakeup w;
+	struct process *waiter, *tmp;
 
 	/* Un-own this resource */
-	r->owner = NULL;
+	resource_put(r);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue))
+	/* Let's wake up the waiters that can take it in the order they came */
+	resource_wakeup_init(&w, r);
+	list_for_each_entry_safe(waiter, tmp, &r->waitqueue, list)
 	{
-		struct process *waiter = list_first_entry(&r->waitqueue, struct process, list);
+		if (resource_wakeup_done(&w, r))
+			break;
+		if (!resource_wakeup(&w, r, waiter))
+			continue;
 
 		/**
 		 * Ensure the waiter is in the wait status
@@ -203,23 +313,139 @@ pick_next:
 	return next;
 }
 
-struct scheduler fifo_scheduler = {
+/**
+ * FIFO never preempts the current process, so it keeps running the current
+ * until the current exits or is blocked
+ */
+static unsigned int fifo_extend(unsigned int nr_ticks)
+{
+	return nr_ticks;
+}
+
+const struct scheduler fifo_scheduler = {
 	.name = "FIFO",
 	.acquire = fcfs_acquire,
 	.release = fcfs_release,
 	.initialize = fifo_initialize,
 	.finalize = fifo_finalize,
 	.schedule = fifo_schedule,
+	.extend = fifo_extend,
 };
 
 /***********************************************************************
  * SJF scheduler
  ***********************************************************************/
+/**
+ * SJF and SRTF keep the ready processes of each CPU in a min-heap on their
+ * (remaining) lifespan. The processes with the same key come out in the
+ * order they became ready, which is the order they are in @readyqueue.
+ */
+struct sjf_rq
+{
+	struct heap heap;
+	unsigned long long seq;
+};
+
+static inline struct sjf_rq *this_sjf_rq(void)
+{
+	return this_cpu->private;
+}
+
+static bool sjf_before(struct process *p, struct process *q)
+{
+	if (p->lifespan != q->lifespan)
+		return p->lifespan < q->lifespan;
+	return p->seq < q->seq;
+}
+
+static inline unsigned int srtf_remaining(struct process *p)
+{
+	return p->lifespan - p->age;
+}
+
+static bool srtf_before(struct process *p, struct process *q)
+{
+	if (srtf_remaining(p) != srtf_remaining(q))
+		return srtf_remaining(p) < srtf_remaining(q);
+	return p->seq < q->seq;
+}
+
+static int __sjf_initialize(bool (*before)(struct process *, struct process *))
+{
+	struct sjf_rq *rq = malloc(sizeof(*rq));
+
+	if (!rq)
+		return -1;
+
+	heap_init(&rq->heap, before);
+	rq->seq = 0;
+
+	this_cpu->private = rq;
+	return 0;
+}
+
+static int sjf_initialize(void)
+{
+	return __sjf_initialize(sjf_before);
+}
+
+static int srtf_initialize(void)
+{
+	return __sjf_initialize(srtf_before);
+}
+
+static void sjf_finalize(void)
+{
+	heap_fini(&this_sjf_rq()->heap);
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
+
+static void sjf_enqueue(struct sjf_rq *rq, struct process *p)
+{
+	p->seq = ++rq->seq;
+	heap_push(&rq->heap, p);
+}
+
+/**
+ * Move the processes in @readyqueue into the heap. They are either forked or
+ * woken up by fcfs_release()
+ */
+static void sjf_enqueue_ready(struct sjf_rq *rq)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list)
+	{
+		list_del_init(&p->list);
+		sjf_enqueue(rq, p);
+	}
+}
+
+static void sjf_forked(struct process *p)
+{
+	list_del_init(&p->list);
+	sjf_enqueue(this_sjf_rq(), p);
+}
+
+static struct process *sjf_detach(void)
+{
+	return heap_pop(&this_sjf_rq()->heap);
+}
+
+static void sjf_attach(struct process *p)
+{
+	list_del_init(&p->list);
+	sjf_enqueue(this_sjf_rq(), p);
+}
+
 static struct process *sjf_schedule(void)
 {
-	struct process *next = NULL;
+	struct sjf_rq *rq = this_sjf_rq();
 	// dump_status();
 
+	sjf_enqueue_ready(rq);
+
 	if (!current || current->status == PROCESS_WAIT)
 	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
 		goto pick_next;
@@ -231,39 +457,21 @@ static struct process *sjf_schedule(void)
 		return current;
 	}
 pick_next:
-	//여기서부터가 이제 중요하지
-	if (!list_empty(&readyqueue))
-	{
-		struct process *temp = NULL; //다음꺼로 선정한것.
-		unsigned int minLife = MAX_LIFESPAN;
-		//readyqueue에서 가장 작은 lifespan을 가진 process를 선정한다.
-		list_for_each_entry(temp, &readyqueue, list)
-		{
-			if (minLife > temp->lifespan)
-				minLife = temp->lifespan;
-		}
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->lifespan == minLife)
-			{
-				list_del_init(&next->list);
-				return next;
-			}
-		}
-	}
-	/**
-	 * Implement your own SJF scheduler here.
-	 */
-	return NULL;
+	/* The shortest job is at the top of the heap */
+	return heap_pop(&rq->heap);
 }
 
-struct scheduler sjf_scheduler = {
+const struct scheduler sjf_scheduler = {
 	.name = "Shortest-Job First",
 	.acquire = fcfs_acquire,  /* Use the default FCFS acquire() */
 	.release = fcfs_release,  /* Use the default FCFS release() */
-	.schedule = sjf_schedule, /* TODO: Assign sjf_schedule()
-								to this function pointer to activate
-								SJF in the system */
+	.initialize = sjf_initialize,
+	.finalize = sjf_finalize,
+	.forked = sjf_forked,
+	.detach = sjf_detach,
+	.attach = sjf_attach,
+	.schedule = sjf_schedule,
+	.extend = fifo_extend,	  /* SJF is non-preemptive as well */
 };
 
 /***********************************************************************
@@ -271,94 +479,157 @@ struct scheduler sjf_scheduler = {
  ***********************************************************************/
 static struct process *srtf_schedule(void)
 {
-	struct process *next = NULL;
-	struct process *temp = NULL;
+	struct sjf_rq *rq = this_sjf_rq();
+	struct process *next;
 	// dump_status();
+
+	sjf_enqueue_ready(rq);
+
 	if (!current || current->status == PROCESS_WAIT)
 	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
 		goto pick_next;
 	}
 	/* The current process has remaining lifetime. Schedule it again */
-	current->prio = current->lifespan - current->age;
 	if (current->age < current->lifespan)
 	{
-		//srtf에서는 실행중인 부분에서 달라진다.
-		//만약 실행중인것의 lifespan-age가 다른 lifespan 보다 낮다면?
-		//lifespan-age가 priority라고 할 수 있다.
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (current->prio > next->prio)
-			{
-				//남아있는 시간이 srtf에서는 Priority가 된다!!
-				list_add_tail(&(current->list), &readyqueue);
-				temp = current;
-				current = next;
-				next = temp;
-				//조건에 만족하는 next가 run될 current가 된다.
-				//남아있는 시간이 더 적은 프로세스와 현재 프로세스를 바꾸어주어야한다.
-				//readyqueue에 다시 넣어주어야한다.
-				// list_add_tail(&(next->list), &readyqueue);
-				list_del_init(&current->list);
-			}
-		}
-		return current;
+		/**
+		 * The current is preempted only by a process with strictly shorter
+		 * remaining time. Then, it goes back to the heap as the last one
+		 * among the processes with the same remaining time.
+		 */
+		next = heap_top(&rq->heap);
+		if (!next || srtf_remaining(next) >= srtf_remaining(current))
+			return current;
+
+		sjf_enqueue(rq, current);
 	}
 pick_next:
-	//여기서부터가 이제 중요하지
-	if (!list_empty(&readyqueue))
+	return heap_pop(&rq->heap);
+}
+
+/**
+ * The remaining time of the current only decreases while no process is
+ * forked nor woken up. So, if nothing preempts the current now, nothing will.
+ */
+static unsigned int srtf_extend(unsigned int nr_ticks)
+{
+	struct process *next;
+
+	/* Processes might be woken up after the last schedule() */
+	sjf_enqueue_ready(this_sjf_rq());
+
+	next = heap_top(&this_sjf_rq()->heap);
+	if (next && srtf_remaining(next) < srtf_remaining(current))
+		return 0;
+
+	return nr_ticks;
+}
+
+const struct scheduler srtf_scheduler = {
+	.name = "Shortest Remaining Time First",
+	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
+	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = srtf_initialize,
+	.finalize = sjf_finalize,
+	.forked = sjf_forked,
+	.detach = sjf_detach,
+	.attach = sjf_attach,
+	.extend = srtf_extend,
+	.schedule = srtf_schedule
+};
+
+/***********************************************************************
+ * Earliest-deadline first scheduler
+ *
+ * Ready processes are kept in the heap of SJF on their absolute deadline.
+ * The processes without a deadline have the latest one, so they run only
+ * when no process with a deadline is ready.
+ ***********************************************************************/
+static bool edf_before(struct process *p, struct process *q)
+{
+	if (p->deadline != q->deadline)
+		return p->deadline < q->deadline;
+	return p->seq < q->seq;
+}
+
+static int edf_initialize(void)
+{
+	return __sjf_initialize(edf_before);
+}
+
+static struct process *edf_schedule(void)
+{
+	struct sjf_rq *rq = this_sjf_rq();
+	struct process *next;
+
+	sjf_enqueue_ready(rq);
+
+	if (!current || current->status == PROCESS_WAIT)
 	{
-		struct process *temp = NULL;
-		unsigned int minLife = MAX_LIFESPAN;
-		//readyqueue에서 가장 작은 lifespan을 가진 process를 선정한다.
-		list_for_each_entry(temp, &readyqueue, list)
-		{
-			if (minLife > temp->prio)
-				minLife = temp->prio;
-		}
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio == minLife)
-			{
-				list_del_init(&next->list);
-				return next;
-			}
-		}
+		goto pick_next;
 	}
-	/**
-	 * Implement your own SJF scheduler here.
-	 */
-	return NULL;
+
+	if (current->age < current->lifespan)
+	{
+		/* Preempt the current only for a strictly earlier deadline */
+		next = heap_top(&rq->heap);
+		if (!next || next->deadline >= current->deadline)
+			return current;
+
+		sjf_enqueue(rq, current);
+	}
+pick_next:
+	return heap_pop(&rq->heap);
 }
-static void strf_forked(struct process *p)
+
+/**
+ * Deadlines do not change, so the current keeps running until a process
+ * with an earlier deadline is forked or woken up
+ */
+static unsigned int edf_extend(unsigned int nr_ticks)
 {
-	// list_add_tail(&p)
-	p->prio = p->lifespan - p->age;
-	// fprintf(stderr, "이건 테스트용 %d\n", p->prio);
+	struct process *next;
+
+	sjf_enqueue_ready(this_sjf_rq());
+
+	next = heap_top(&this_sjf_rq()->heap);
+	if (next && next->deadline < current->deadline)
+		return 0;
+
+	return nr_ticks;
 }
 
-struct scheduler srtf_scheduler = {
-	.name = "Shortest Remaining Time First",
+const struct scheduler edf_scheduler = {
+	.name = "Earliest-Deadline First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
-	.forked = strf_forked,
-	.schedule = srtf_schedule /* You need to check the newly created processes to implement SRTF.
-	 * Use @forked() callback to mark newly created processes */
-							  /* Obviously, you should implement srtf_schedule() and attach it here */
+	.initialize = edf_initialize,
+	.finalize = sjf_finalize,
+	.forked = sjf_forked,
+	.detach = sjf_detach,
+	.attach = sjf_attach,
+	.extend = edf_extend,
+	.schedule = edf_schedule
 };
 
 /***********************************************************************
  * Round-robin scheduler
- * 1tick이 time quantum이다. 
+ * The time quantum is 1 tick by default, and can be set with -Q or the rr
+ * block in the script.
  * 한프로세스가 한틱마다 readyque의 맨뒤로 그냥가면 된다. 
  * 기본은 fifo방식이다,
  ***********************************************************************/
+static inline unsigned int rr_quantum(void)
+{
+	return (this_sim->config.flags & CONFIG_RR_QUANTUM) ? this_sim->config.rr.quantum : 1;
+}
+
 static struct process *rr_schedule(void)
 {
 	struct process *next = NULL;
 
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
-	struct process *temp = NULL;
 	/**
 	 * When there was no process to run in the previous tick (so does
 	 * in the very beginning of the simulation), there will be
@@ -376,10 +647,11 @@ static struct process *rr_schedule(void)
 	/* The current process has remaining lifetime. Schedule it again */
 	if (current->age < current->lifespan)
 	{
+		/* Keep running until the time slice expires */
+		if (++current->slice < rr_quantum())
+			return current;
+
 		list_add_tail(&(current->list), &readyqueue);
-		next = list_first_entry(&readyqueue, struct process, list);
-		list_del_init(&next->list);
-		return next;
 	}
 
 pick_next:
@@ -398,139 +670,200 @@ pick_next:
 		 * the framework will complain (assert) on process exit.
 		 */
 		list_del_init(&next->list);
+
+		/* A new time slice begins */
+		next->slice = 0;
 	}
 
 	/* Return the next process to run */
 	return next;
 }
 
-struct scheduler rr_scheduler = {
+/**
+ * The current runs through the rest of its time slice. It starts over time
+ * slices on its own if it is the only one to run
+ */
+static unsigned int rr_extend(unsigned int nr_ticks)
+{
+	unsigned int quantum = rr_quantum();
+
+	if (list_empty(&readyqueue))
+	{
+		current->slice = (current->slice + nr_ticks) % quantum;
+		return nr_ticks;
+	}
+
+	if (quantum - current->slice - 1 < nr_ticks)
+		nr_ticks = quantum - current->slice - 1;
+
+	current->slice += nr_ticks;
+	return nr_ticks;
+}
+
+const struct scheduler rr_scheduler = {
 	.name = "Round-Robin",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.extend = rr_extend,
 	.schedule = rr_schedule	 /* Obviously, you should implement rr_schedule() and attach it here */
 };
 
 /***********************************************************************
  * Priority scheduler
  ***********************************************************************/
-static struct process *prio_schedule(void)
+/**
+ * Each CPU has a run queue for the priority-based schedulers. The framework
+ * forks processes into @readyqueue, and the forked() callback moves them into
+ * the run queue of the CPU.
+ */
+static inline struct runqueue *this_rq(void)
 {
-	struct process *next = NULL;
-
-	/* You may inspect the situation by calling dump_status() at any time */
-	// dump_status();
-	struct process *temp = NULL;
-	struct process *temp2 = NULL;
+	return this_cpu->private;
+}
 
-	// fprintf(stderr, "test\n");
-	/**
-	 * When there was no process to run in the previous tick (so does
-	 * in the very beginning of the simulation), there will be
-	 * no @current process. In this case, pick the next without examining
-	 * the current process. Also, when the current process is blocked
-	 * while acquiring a resource, @current is (supposed to be) attached
-	 * to the waitqueue of the corresponding resource. In this case just
-	 * pick the next as well.
-	 */
-	if (!current || current->status == PROCESS_WAIT)
-	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
-		goto pick_next;
-	}
+static int prio_initialize(void)
+{
+	struct runqueue *rq = malloc(sizeof(*rq));
 
-	/* The current process has remaining lifetime. Schedule it again */
-	if (current->age < current->lifespan)
-	{
-		list_add_tail(&(current->list), &readyqueue);
+	if (!rq)
+		return -1;
 
-		temp = current;
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio > temp->prio)
-			{
-				temp = next;
-			}
-			else if (next->prio == temp->prio)
-			{
+	rq_init(rq);
+	this_cpu->private = rq;
+	return 0;
+}
 
-				if (temp->prio > current->prio)
-					continue; //이미 한번 바뀐거니까! 또바뀔이유 없지?
-				temp = next;  //이렇게 하면 계속 똑같은게 나왔을 때 결국 마지막에는 current와 일치하게됨
-				if (temp == current)
-				{ //prio 가 있어도 동일한 Prio에 대해서는 rr 방식으로
-
-					//반복문의 next(현재)와 current가 같다면?
-					list_for_each_entry(temp2, &readyqueue, list)
-					{
-						if (temp2->prio == current->prio)
-						{
-							//처음으로 current와 같은것을 출력하는 것.
-							temp = temp2;
-							break;
-						}
-					}
-				}
-			}
-			else
-			{
-				continue; //current는 변함 없으므로 temp에 넣어두자!
-			}
-		}
-		//temp가 결국 최종적으로 나오게 될것.
-		list_del_init(&temp->list);
-		// list_del_init(&next->list);
-		return temp;
-	}
+static void prio_finalize(void)
+{
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
 
-pick_next:
-	/* Let's pick a new process to run next */
-	if (!list_empty(&readyqueue))
+static void prio_forked(struct process *p)
+{
+	list_del_init(&p->list);
+	rq_enqueue(this_rq(), p);
+}
+
+/**
+ * Give away the process that this CPU would run next
+ */
+static struct process *prio_detach(void)
+{
+	return rq_dequeue(this_rq());
+}
+
+/**
+ * The waiters of a resource are kept in a run queue as well, so that the one
+ * with the highest priority is woken up without walking the wait queue. The
+ * waiters with the same priority are woken up in the order they came.
+ */
+static void prio_wait(struct resource *r, struct process *p)
+{
+	if (!r->waiters)
 	{
-		struct process *old = NULL;
-		struct process *temp = NULL;
+		r->waiters = malloc(sizeof(*r->waiters));
+		assert(r->waiters);
+		rq_init(r->waiters);
+	}
+	rq_enqueue(r->waiters, p);
+}
 
-		/**
-		 * If the ready queue is not empty, pick the first process
-		 * in the ready queue
-		 */
-		next = list_first_entry(&readyqueue, struct process, list);
-		/**
-		 * Detach the process from the ready queue. Note we use list_del_init()
-		 * instead of list_del() to maintain the list head tidy. Otherwise,
-		 * the framework will complain (assert) on process exit.
-		 */
-		list_for_each_entry(old, &readyqueue, list)
+/**
+ * Take out the next waiter that can take @r along with the ones taken out so
+ * far in @w, in the order of their priority. NULL if no more can take it
+ */
+static struct process *prio_wake(struct resource *r, struct resource_wakeup *w)
+{
+	struct process *p, *tmp;
+
+	if (!r->waiters || resource_wakeup_done(w, r))
+		return NULL;
+
+	/* The top one usually takes it, so look into the others only if not */
+	p = rq_peek(r->waiters);
+	if (!p || resource_wakeup(w, r, p))
+		return rq_dequeue(r->waiters);
+
+	for (int level = NR_RQ_LEVELS - 1; level >= 0; level--)
+	{
+		list_for_each_entry_safe(p, tmp, r->waiters->queues + level, list)
 		{
-			if (next->prio < old->prio)
+			if (resource_wakeup(w, r, p))
 			{
-				temp = next;
-				next = old;
-				old = temp;
+				rq_remove(p);
+				return p;
 			}
 		}
-		list_del_init(&next->list);
 	}
-	/* Return the next process to run */
-	return next;
+	return NULL;
+}
+
+static struct process *prio_schedule(void)
+{
+	/* You may inspect the situation by calling dump_status() at any time */
+	// dump_status();
+
+	/**
+	 * When there was no process to run in the previous tick (so does
+	 * in the very beginning of the simulation), there will be
+	 * no @current process. In this case, pick the next without examining
+	 * the current process. Also, when the current process is blocked
+	 * while acquiring a resource, @current is (supposed to be) attached
+	 * to the waitqueue of the corresponding resource. In this case just
+	 * pick the next as well.
+	 */
+	if (!current || current->status == PROCESS_WAIT)
+	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
+		goto pick_next;
+	}
+
+	/**
+	 * The current process has remaining lifetime. Put it at the tail of its
+	 * priority level so that it is switched with the processes with the same
+	 * priority.
+	 */
+	if (current->age < current->lifespan)
+	{
+		rq_enqueue(this_rq(), current);
+	}
+
+pick_next:
+	/* Pick the first process in the highest non-empty priority level */
+	return rq_dequeue(this_rq());
+}
+
+/**
+ * The current keeps running unless a process with the same or higher
+ * priority is ready, which does not change until some event happens
+ */
+static unsigned int prio_extend(unsigned int nr_ticks)
+{
+	struct process *next = rq_peek(this_rq());
+
+	if (next && next->prio >= current->prio)
+		return 0;
+
+	return nr_ticks;
 }
 //이함수는 acquire가 발생할때!
-bool prio_acquire(int resource_id)
+bool prio_acquire(int resource_id, enum resource_mode mode)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner)
+	if (resource_available(r, mode))
 	{
 		/* This resource is not owned by any one. Take it! */
 		//아무도 리소스를 갖고 있지 않다면 owner가 되겠지?
 		//current가 owner가 된다.
-		r->owner = current;
+		resource_take(r, mode);
 
 		return true;
 	}
 	else
 	{
 		//resource의 owner가 존재하는 경우
-		if (r->owner->pid != current->pid)
+		if (r->owner != current)
 		{
 			//owner가 존재하긴 하는데 current가 그 owner가 아니라면?
 			//만약 누군가 리소스를 갖고있다면 이녀석은 waitqueue로 들어가고 current가 바뀌어야 맞겠지?
@@ -539,12 +872,12 @@ bool prio_acquire(int resource_id)
 
 			/* Update the current process state */
 
-			current->status = PROCESS_WAIT;
+			resource_wait(r, mode);
 
 			/** And append wait to waitqueue 
 	 * resource를 가지고 있는 놈이 끝나기전까지 이 프로세스는 ready상태로 들어있을 수 없음.
 	*/
-			list_add_tail(&current->list, &r->waitqueue);
+			prio_wait(r, current);
 			//waitqueue에 넣고 새롭게 실행할 process를 찾는다.
 			// current = prio_schedule();
 			/**
@@ -562,45 +895,21 @@ void prio_release(int resource_id)
 {
 	//release를 해줄 때 가장 높은 priority를 가지고 있는 waitqueue를 뽑아주어야 한다.
 	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	struct resource_wakeup w;
+	struct process *waiter;
 
 	/* Un-own this resource */
-	r->owner = NULL;
+	resource_put(r);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue))
+	/* Let's wake up the waiters that can take it in the order of priority */
+	resource_wakeup_init(&w, r);
+	while ((waiter = prio_wake(r, &w)))
 	{
-		struct process *iterater;
-
-		struct process *waiter =
-			list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(iterater, &r->waitqueue, list)
-		{
-			//해당 resource를 wait하고 있는 것들중에 가장 Pior가 높은 것을
-			//readyqueue로 변환하기 위한 작업.
-
-			if (waiter->prio < iterater->prio)
-			{
-				//iterater와 temp의 값을 바꾼다.
-				waiter = iterater;
-			}
-		}
-
 		/**
 		 * Ensure the waiter is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
-
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
 		//release를 하니까 프로세스의 상태를 다시 레디로 바꾸어주는 것.
@@ -608,15 +917,21 @@ void prio_release(int resource_id)
 		 * Put the waiter process into ready queue. The framework will
 		 * do the rest.
 		 */
-		list_add_tail(&waiter->list, &readyqueue);
+		rq_enqueue(this_rq(), waiter);
 		//wait하던게 readyqueue로 넘어오면서 다시 스케쥴링이 되게끔!!
 	}
 }
 
-struct scheduler prio_scheduler = {
+const struct scheduler prio_scheduler = {
 	.name = "Priority",
 	.acquire = prio_acquire,
 	.release = prio_release,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.forked = prio_forked,
+	.detach = prio_detach,
+	.attach = prio_forked,
+	.extend = prio_extend,
 	.schedule = prio_schedule
 	/**
 	 * Implement your own acqure/release function to make priority
@@ -628,14 +943,209 @@ struct scheduler prio_scheduler = {
 /***********************************************************************
  * Priority scheduler with aging
  ***********************************************************************/
+/**
+ * Aging everyone in the run queue on every tick is O(n). Instead, the run
+ * queue counts the aging events in @nr_aged (all of them) and @nr_boosted
+ * (the ones not capped at MAX_PRIO), and each process remembers the count
+ * when it is enqueued in @p->epoch. Then, the effective priority is derived
+ * from @p->prio, the priority when it was enqueued, lazily.
+ *
+ * Processes below MAX_PRIO are aged by every event. Their effective
+ * priority is @p->prio + @nr_aged - @p->epoch, and it stays in
+ * [0, MAX_PRIO), so they are hashed into MAX_PRIO @slots by
+ * (@p->prio - @p->epoch) % MAX_PRIO. The slot of priority level l is
+ * (l - @nr_aged) % MAX_PRIO, so an aging event just rotates the levels by
+ * one, and the slot that reaches MAX_PRIO moves into @boosted.
+ *
+ * Processes at or above MAX_PRIO are aged only by the uncapped events.
+ * They are in @boosted, ordered by @p->prio + @nr_boosted - @p->epoch and
+ * by the enqueueing order.
+ */
+#if MAX_PRIO > 64
+#error "struct pa_rq assumes that MAX_PRIO levels fit in a 64-bit bitmap"
+#endif
+
+struct pa_rq
+{
+	unsigned long long bitmap; /* Non-empty slots */
+	struct list_head slots[MAX_PRIO];
+	struct heap boosted;
+
+	unsigned long long nr_aged;
+	unsigned long long nr_boosted;
+	unsigned long long seq;
+};
+
+static inline struct pa_rq *this_pa_rq(void)
+{
+	return this_cpu->private;
+}
+
+static inline unsigned int pa_slot(struct pa_rq *rq, unsigned long long level)
+{
+	return (level - rq->nr_aged) % MAX_PRIO;
+}
+
+static bool pa_boosted_before(struct process *p, struct process *q)
+{
+	if (p->prio + q->epoch != q->prio + p->epoch)
+		return p->prio + q->epoch > q->prio + p->epoch;
+	return p->seq < q->seq;
+}
+
+static void pa_enqueue(struct pa_rq *rq, struct process *p)
+{
+	p->seq = ++rq->seq;
+
+	if (p->prio >= MAX_PRIO)
+	{
+		p->epoch = rq->nr_boosted;
+		heap_push(&rq->boosted, p);
+	}
+	else
+	{
+		unsigned int slot = pa_slot(rq, p->prio);
+
+		p->epoch = rq->nr_aged;
+		list_add_tail(&p->list, rq->slots + slot);
+		rq->bitmap |= 1ULL << slot;
+	}
+}
+
+/**
+ * The highest priority level of the processes below MAX_PRIO. The bitmap of
+ * slots is rotated to be the bitmap of levels.
+ */
+static inline int pa_top_level(struct pa_rq *rq)
+{
+	unsigned int shift = rq->nr_aged % MAX_PRIO;
+	unsigned long long levels = rq->bitmap;
+
+	if (!levels)
+		return -1;
+
+	if (shift)
+		levels = ((levels << shift) | (levels >> (MAX_PRIO - shift))) &
+				 (~0ULL >> (64 - MAX_PRIO));
+
+	return 63 - __builtin_clzll(levels);
+}
+
+/**
+ * Take out the process with the highest effective priority, which is set to
+ * @p->prio. The one enqueued first goes out among the processes with the
+ * same priority.
+ */
+static struct process *pa_dequeue(struct pa_rq *rq)
+{
+	struct process *p = heap_pop(&rq->boosted);
+	unsigned int slot;
+	int level;
+
+	if (p)
+	{
+		p->prio += rq->nr_boosted - p->epoch;
+		return p;
+	}
+
+	level = pa_top_level(rq);
+	if (level < 0)
+		return NULL;
+
+	slot = pa_slot(rq, level);
+	p = list_first_entry(rq->slots + slot, struct process, list);
+	list_del_init(&p->list);
+	if (list_empty(rq->slots + slot))
+		rq->bitmap &= ~(1ULL << slot);
+
+	p->prio = level;
+	return p;
+}
+
+/**
+ * The highest effective priority in the run queue, or -1 if it is empty
+ */
+static long long pa_top_prio(struct pa_rq *rq)
+{
+	struct process *p = heap_top(&rq->boosted);
+
+	if (p)
+		return p->prio + rq->nr_boosted - p->epoch;
+
+	return pa_top_level(rq);
+}
+
+/**
+ * Boost all processes in the run queue by one. When @capped is true,
+ * processes at MAX_PRIO or higher are not boosted.
+ */
+static void pa_age(struct pa_rq *rq, bool capped)
+{
+	unsigned int slot;
+	struct process *p, *tmp;
+
+	rq->nr_aged++;
+	if (!capped)
+		rq->nr_boosted++;
+
+	/* The slot rotated from MAX_PRIO - 1 to MAX_PRIO, which is out of range */
+	slot = pa_slot(rq, MAX_PRIO);
+	if (!(rq->bitmap & (1ULL << slot)))
+		return;
+
+	list_for_each_entry_safe(p, tmp, rq->slots + slot, list)
+	{
+		list_del_init(&p->list);
+		p->prio = MAX_PRIO;
+		p->epoch = rq->nr_boosted;
+		heap_push(&rq->boosted, p);
+	}
+	rq->bitmap &= ~(1ULL << slot);
+}
+
+static int pa_initialize(void)
+{
+	struct pa_rq *rq = malloc(sizeof(*rq));
+
+	if (!rq)
+		return -1;
+
+	rq->bitmap = 0;
+	for (int i = 0; i < MAX_PRIO; i++)
+	{
+		INIT_LIST_HEAD(rq->slots + i);
+	}
+	heap_init(&rq->boosted, pa_boosted_before);
+	rq->nr_aged = rq->nr_boosted = rq->seq = 0;
+
+	this_cpu->private = rq;
+	return 0;
+}
+
+static void pa_finalize(void)
+{
+	heap_fini(&this_pa_rq()->boosted);
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
+
+static void pa_forked(struct process *p)
+{
+	list_del_init(&p->list);
+	pa_enqueue(this_pa_rq(), p);
+}
+
+static struct process *pa_detach(void)
+{
+	return pa_dequeue(this_pa_rq());
+}
+
 static struct process *pa_schedule(void)
 {
 	struct process *next = NULL;
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
-	struct process *temp = NULL;
-	struct process *temp2 = NULL;
-	// fprintf(stderr, "test\n");
+
 	/**
 	 * When there was no process to run in the previous tick (so does
 	 * in the very beginning of the simulation), there will be
@@ -653,112 +1163,72 @@ static struct process *pa_schedule(void)
 	/* The current process has remaining lifetime. Schedule it again */
 	if (current->age < current->lifespan)
 	{
-		// list_add_tail(&(current->list), &readyqueue);
-		// next = list_first_entry(&readyqueue, struct process, list);
 		//우선 readyqueue 마지막에 넣어둔다.
-		list_add_tail(&(current->list), &readyqueue);
+		pa_enqueue(this_pa_rq(), current);
 
-		temp = current;
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio > temp->prio)
-			{
-				temp = next;
-			}
-			else if (next->prio == temp->prio)
-			{
-
-				if (temp->prio > current->prio)
-					continue; //이미 한번 바뀐거니까! 또바뀔이유 없지?
-				temp = next;  //이렇게 하면 계속 똑같은게 나왔을 때 결국 마지막에는 current와 일치하게됨
-				if (temp == current)
-				{ //prio 가 있어도 동일한 Prio에 대해서는 rr 방식으로
-
-					//반복문의 next(현재)와 current가 같다면?
-					list_for_each_entry(temp2, &readyqueue, list)
-					{
-						if (temp2->prio == current->prio)
-						{
-							//처음으로 current와 같은것을 출력하는 것.
-							temp = temp2;
-							break;
-						}
-					}
-				}
-			}
-			else
-			{
-				continue; //current는 변함 없으므로 temp에 넣어두자!
-			}
-		}
-		//temp가 결국 최종적으로 나오게 될것.
-		list_del_init(&temp->list);
-		temp->prio = temp->prio_orig;
+		next = pa_dequeue(this_pa_rq());
+		next->prio = next->prio_orig;
 
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio >= MAX_PRIO)
-				continue;
-			next->prio++;
-		}
-		return temp;
+		/* Others get aged up to MAX_PRIO */
+		pa_age(this_pa_rq(), true);
+		return next;
 	}
 
 pick_next:
 	/* Let's pick a new process to run next */
-	if (!list_empty(&readyqueue))
+	next = pa_dequeue(this_pa_rq());
+	if (next)
 	{
-		struct process *old = NULL;
-		struct process *temp = NULL;
-
-		/**
-		 * If the ready queue is not empty, pick the first process
-		 * in the ready queue
-		 */
-		next = list_first_entry(&readyqueue, struct process, list);
-		/**
-		 * Detach the process from the ready queue. Note we use list_del_init()
-		 * instead of list_del() to maintain the list head tidy. Otherwise,
-		 * the framework will complain (assert) on process exit.
-		 */
-		list_for_each_entry(old, &readyqueue, list)
-		{
-			if (next->prio < old->prio)
-			{
-				temp = next;
-				next = old;
-				old = temp;
-			}
-		}
 		next->prio = next->prio_orig;
-		list_del_init(&next->list);
 
-		list_for_each_entry(temp, &readyqueue, list)
-		{
-			temp->prio++;
-		}
+		pa_age(this_pa_rq(), false);
 	}
 	/* Return the next process to run */
 	return next;
 }
+
+/**
+ * The ready processes get closer to the current by one priority level on
+ * each tick. The current keeps running until one of them catches up.
+ */
+static unsigned int pa_extend(unsigned int nr_ticks)
+{
+	long long prio = pa_top_prio(this_pa_rq());
+
+	if (prio >= 0)
+	{
+		if (prio >= current->prio)
+			return 0;
+
+		if (current->prio - prio < nr_ticks)
+			nr_ticks = current->prio - prio;
+
+		for (unsigned int i = 0; i < nr_ticks; i++)
+		{
+			pa_age(this_pa_rq(), true);
+		}
+	}
+	return nr_ticks;
+}
+
 //이함수는 acquire가 발생할때!
-bool pa_acquire(int resource_id)
+bool pa_acquire(int resource_id, enum resource_mode mode)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner)
+	if (resource_available(r, mode))
 	{
 		/* This resource is not owned by any one. Take it! */
 		//아무도 리소스를 갖고 있지 않다면 owner가 되겠지?
 		//current가 owner가 된다.
-		r->owner = current;
+		resource_take(r, mode);
 
 		return true;
 	}
 	else
 	{
 		//resource의 owner가 존재하는 경우
-		if (r->owner->pid != current->pid)
+		if (r->owner != current)
 		{
 			//owner가 존재하긴 하는데 current가 그 owner가 아니라면?
 			//만약 누군가 리소스를 갖고있다면 이녀석은 waitqueue로 들어가고 current가 바뀌어야 맞겠지?
@@ -767,12 +1237,12 @@ bool pa_acquire(int resource_id)
 
 			/* Update the current process state */
 
-			current->status = PROCESS_WAIT;
+			resource_wait(r, mode);
 
 			/** And append wait to waitqueue 
 	 * resource를 가지고 있는 놈이 끝나기전까지 이 프로세스는 ready상태로 들어있을 수 없음.
 	*/
-			list_add_tail(&current->list, &r->waitqueue);
+			prio_wait(r, current);
 			/**
 	 * And return false to indicate the resource is not available.
 	 * The scheduler framework will soon call schedule() function to
@@ -788,44 +1258,21 @@ void pa_release(int resource_id)
 {
 	//release를 해줄 때 가장 높은 priority를 가지고 있는 waitqueue를 뽑아주어야 한다.
 	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	struct resource_wakeup w;
+	struct process *waiter;
 
 	/* Un-own this resource */
-	r->owner = NULL;
+	resource_put(r);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue))
+	/* Let's wake up the waiters that can take it in the order of priority */
+	resource_wakeup_init(&w, r);
+	while ((waiter = prio_wake(r, &w)))
 	{
-		struct process *iterater;
-
-		struct process *waiter =
-			list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(iterater, &r->waitqueue, list)
-		{
-			//해당 resource를 wait하고 있는 것들중에 가장 Pior가 높은 것을
-			//readyqueue로 변환하기 위한 작업.
-			if (waiter->prio < iterater->prio)
-			{
-				//iterater와 temp의 값을 바꾼다.
-				waiter = iterater;
-			}
-		}
-
 		/**
 		 * Ensure the waiter is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
-
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
 		//release를 하니까 프로세스의 상태를 다시 레디로 바꾸어주는 것.
@@ -833,15 +1280,21 @@ void pa_release(int resource_id)
 		 * Put the waiter process into ready queue. The framework will
 		 * do the rest.
 		 */
-		list_add_tail(&waiter->list, &readyqueue);
+		pa_enqueue(this_pa_rq(), waiter);
 		//wait하던게 readyqueue로 넘어오면서 다시 스케쥴링이 되게끔!!
 	}
 }
 
-struct scheduler pa_scheduler = {
+const struct scheduler pa_scheduler = {
 	.name = "Priority + aging",
 	.acquire = pa_acquire,
 	.release = pa_release,
+	.initialize = pa_initialize,
+	.finalize = pa_finalize,
+	.forked = pa_forked,
+	.detach = pa_detach,
+	.attach = pa_forked,
+	.extend = pa_extend,
 	.schedule = pa_schedule
 	/**
 	 * Implement your own acqure/release function to make priority
@@ -853,124 +1306,24 @@ struct scheduler pa_scheduler = {
 /***********************************************************************
  * Priority scheduler with priority ceiling protocol
  ***********************************************************************/
-static struct process *pcp_schedule(void)
+bool pcp_acquire(int resource_id, enum resource_mode mode)
 {
-	struct process *next = NULL;
+	struct resource *r = resources + resource_id;
 
-	/* You may inspect the situation by calling dump_status() at any time */
-	// dump_status();
-	struct process *temp = NULL;
-	struct process *temp2 = NULL;
+	if (resource_available(r, mode))
+	{
+		/* This resource is not owned by any one. Take it! */
+		//아무도 리소스를 갖고 있지 않다면 owner가 되겠지?
+		//current가 owner가 된다.
+		resource_take(r, mode);
 
-	// fprintf(stderr, "test\n");
-	/**
-	 * When there was no process to run in the previous tick (so does
-	 * in the very beginning of the simulation), there will be
-	 * no @current process. In this case, pick the next without examining
-	 * the current process. Also, when the current process is blocked
-	 * while acquiring a resource, @current is (supposed to be) attached
-	 * to the waitqueue of the corresponding resource. In this case just
-	 * pick the next as well.
-	 */
-	if (!current || current->status == PROCESS_WAIT)
-	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
-		goto pick_next;
-	}
-
-	/* The current process has remaining lifetime. Schedule it again */
-	if (current->age < current->lifespan)
-	{
-		list_add_tail(&(current->list), &readyqueue);
-
-		temp = current;
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio > temp->prio)
-			{
-				temp = next;
-			}
-			else if (next->prio == temp->prio)
-			{
-
-				if (temp->prio > current->prio)
-					continue; //이미 한번 바뀐거니까! 또바뀔이유 없지?
-				temp = next;  //이렇게 하면 계속 똑같은게 나왔을 때 결국 마지막에는 current와 일치하게됨
-				if (temp == current)
-				{ //prio 가 있어도 동일한 Prio에 대해서는 rr 방식으로
-
-					//반복문의 next(현재)와 current가 같다면?
-					list_for_each_entry(temp2, &readyqueue, list)
-					{
-						if (temp2->prio == current->prio)
-						{
-							//처음으로 current와 같은것을 출력하는 것.
-							temp = temp2;
-							break;
-						}
-					}
-				}
-			}
-			else
-			{
-				continue; //current는 변함 없으므로 temp에 넣어두자!
-			}
-		}
-		//temp가 결국 최종적으로 나오게 될것.
-		list_del_init(&temp->list);
-		// list_del_init(&next->list);
-		return temp;
-	}
-
-pick_next:
-	/* Let's pick a new process to run next */
-	if (!list_empty(&readyqueue))
-	{
-		struct process *old = NULL;
-		struct process *temp = NULL;
-
-		/**
-		 * If the ready queue is not empty, pick the first process
-		 * in the ready queue
-		 */
-		next = list_first_entry(&readyqueue, struct process, list);
-		/**
-		 * Detach the process from the ready queue. Note we use list_del_init()
-		 * instead of list_del() to maintain the list head tidy. Otherwise,
-		 * the framework will complain (assert) on process exit.
-		 */
-		list_for_each_entry(old, &readyqueue, list)
-		{
-			if (next->prio < old->prio)
-			{
-				temp = next;
-				next = old;
-				old = temp;
-			}
-		}
-		list_del_init(&next->list);
-	}
-	/* Return the next process to run */
-	return next;
-}
-//이함수는 acquire가 발생할때!
-bool pcp_acquire(int resource_id)
-{
-	struct resource *r = resources + resource_id;
-
-	if (!r->owner)
-	{
-		/* This resource is not owned by any one. Take it! */
-		//아무도 리소스를 갖고 있지 않다면 owner가 되겠지?
-		//current가 owner가 된다.
-		r->owner = current;
-
-		r->owner->prio = MAX_PRIO;
+		current->prio = MAX_PRIO;
 		return true;
 	}
 	else
 	{
 		//resource의 owner가 존재하는 경우
-		if (r->owner->pid != current->pid)
+		if (r->owner != current)
 		{
 			//owner가 존재하긴 하는데 current가 그 owner가 아니라면?
 			//만약 누군가 리소스를 갖고있다면 이녀석은 waitqueue로 들어가고 current가 바뀌어야 맞겠지?
@@ -979,10 +1332,13 @@ bool pcp_acquire(int resource_id)
 
 			/* Update the current process state */
 
-			current->status = PROCESS_WAIT;
+			resource_wait(r, mode);
 
 			/** And append wait to waitqueue 
 	 * resource를 가지고 있는 놈이 끝나기전까지 이 프로세스는 ready상태로 들어있을 수 없음.
+	*/
+			prio_wait(r, current);
+			/**
 	 * And return false to indicate the resource is not available.
 	 * The scheduler framework will soon call schedule() function to
 	 * schedule out current and to pick the next process to run.
@@ -997,45 +1353,22 @@ void pcp_release(int resource_id)
 {
 	//release를 해줄 때 가장 높은 priority를 가지고 있는 waitqueue를 뽑아주어야 한다.
 	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	struct resource_wakeup w;
+	struct process *waiter;
 
 	/* Un-own this resource */
-	r->owner->prio = r->owner->prio_orig;
-	r->owner = NULL;
+	current->prio = current->prio_orig;
+	resource_put(r);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue))
+	/* Let's wake up the waiters that can take it in the order of priority */
+	resource_wakeup_init(&w, r);
+	while ((waiter = prio_wake(r, &w)))
 	{
-		struct process *iterater;
-
-		struct process *waiter =
-			list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(iterater, &r->waitqueue, list)
-		{
-			//해당 resource를 wait하고 있는 것들중에 가장 Pior가 높은 것을
-			//readyqueue로 변환하기 위한 작업.
-			if (waiter->prio < iterater->prio)
-			{
-				//iterater와 temp의 값을 바꾼다.
-				waiter = iterater;
-			}
-		}
-
 		/**
 		 * Ensure the waiter is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
-
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
 		//release를 하니까 프로세스의 상태를 다시 레디로 바꾸어주는 것.
@@ -1043,16 +1376,22 @@ void pcp_release(int resource_id)
 		 * Put the waiter process into ready queue. The framework will
 		 * do the rest.
 		 */
-		list_add_tail(&waiter->list, &readyqueue);
+		rq_enqueue(this_rq(), waiter);
 		//wait하던게 readyqueue로 넘어오면서 다시 스케쥴링이 되게끔!!
 	}
 }
 
-struct scheduler pcp_scheduler = {
+const struct scheduler pcp_scheduler = {
 	.name = "Priority + PCP Protocol",
 	.acquire = pcp_acquire,
 	.release = pcp_release,
-	.schedule = pcp_schedule
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.forked = prio_forked,
+	.detach = prio_detach,
+	.attach = prio_forked,
+	.extend = prio_extend,
+	.schedule = prio_schedule
 	/**
 	 * Implement your own acqure/release function too to make priority
 	 * scheduler correct.
@@ -1061,125 +1400,94 @@ struct scheduler pcp_scheduler = {
 
 /***********************************************************************
  * Priority scheduler with priority inheritance protocol
+ *
+ * A blocked process waits for one resource, and a mutex has one owner.
+ * So, the wait-for graph is a set of chains from the waiters through the
+ * owners, and the priority is passed down along the chain of the blocked
+ * process. A chain ends at a resource held shared or by many writers, which
+ * has no owner to pass the priority to. A new edge makes a cycle only if the chain comes back to the
+ * blocked process, so the deadlock is found by walking the same chain
+ * without looking at the other resources.
  ***********************************************************************/
-static struct process *pip_schedule(void)
+static void pip_set_prio(struct process *p, unsigned int prio)
 {
-	struct process *next = NULL;
+	/* The process might be waiting in the run queue or a wait queue */
+	if (p->status == PROCESS_READY || p->status == PROCESS_WAIT)
+		rq_reprio(p, prio);
+	else
+		p->prio = prio;
+}
 
-	/* You may inspect the situation by calling dump_status() at any time */
-	// dump_status();
-	struct process *temp = NULL;
-	struct process *temp2 = NULL;
+/**
+ * Pass the priority of @p to the owners down its chain. An owner runs one
+ * above its waiter that outranks it
+ */
+static void pip_inherit(struct process *p)
+{
+	struct resource *r;
 
-	// fprintf(stderr, "test\n");
-	/**
-	 * When there was no process to run in the previous tick (so does
-	 * in the very beginning of the simulation), there will be
-	 * no @current process. In this case, pick the next without examining
-	 * the current process. Also, when the current process is blocked
-	 * while acquiring a resource, @current is (supposed to be) attached
-	 * to the waitqueue of the corresponding resource. In this case just
-	 * pick the next as well.
-	 */
-	if (!current || current->status == PROCESS_WAIT)
-	{ //현재 프로세스가 없거나 프로세스의 상태가 wait이면 pick_next로가라.
-		goto pick_next;
+	while ((r = p->waiting_for) && r->owner && p->prio > r->owner->prio)
+	{
+		pip_set_prio(r->owner, p->prio + 1);
+		p = r->owner;
 	}
+}
 
-	/* The current process has remaining lifetime. Schedule it again */
-	if (current->age < current->lifespan)
-	{
-		list_add_tail(&(current->list), &readyqueue);
+/**
+ * The priority of @p inherited from the waiters of the resources it holds
+ */
+static unsigned int pip_inherited_prio(struct process *p)
+{
+	struct resource *r;
+	unsigned int prio = p->prio_orig;
 
-		temp = current;
-		list_for_each_entry(next, &readyqueue, list)
-		{
-			if (next->prio > temp->prio)
-			{
-				temp = next;
-			}
-			else if (next->prio == temp->prio)
-			{
+	list_for_each_entry(r, &p->held, held_list)
+	{
+		struct process *waiter = r->waiters ? rq_peek(r->waiters) : NULL;
 
-				if (temp->prio > current->prio)
-					continue; //이미 한번 바뀐거니까! 또바뀔이유 없지?
-				temp = next;  //이렇게 하면 계속 똑같은게 나왔을 때 결국 마지막에는 current와 일치하게됨
-				if (temp == current)
-				{ //prio 가 있어도 동일한 Prio에 대해서는 rr 방식으로
-
-					//반복문의 next(현재)와 current가 같다면?
-					list_for_each_entry(temp2, &readyqueue, list)
-					{
-						if (temp2->prio == current->prio)
-						{
-							//처음으로 current와 같은것을 출력하는 것.
-							temp = temp2;
-							break;
-						}
-					}
-				}
-			}
-			else
-			{
-				continue; //current는 변함 없으므로 temp에 넣어두자!
-			}
-		}
-		//temp가 결국 최종적으로 나오게 될것.
-		list_del_init(&temp->list);
-		// list_del_init(&next->list);
-		return temp;
+		if (waiter && waiter->prio > p->prio_orig && waiter->prio + 1 > prio)
+			prio = waiter->prio + 1;
 	}
+	return prio;
+}
 
-pick_next:
-	/* Let's pick a new process to run next */
-	if (!list_empty(&readyqueue))
-	{
-		struct process *old = NULL;
-		struct process *temp = NULL;
+/**
+ * Tell whether the chain of @p comes back to @p
+ */
+static bool pip_deadlocked(struct process *p)
+{
+	struct process *owner = p->waiting_for->owner;
 
-		/**
-		 * If the ready queue is not empty, pick the first process
-		 * in the ready queue
-		 */
-		next = list_first_entry(&readyqueue, struct process, list);
-		/**
-		 * Detach the process from the ready queue. Note we use list_del_init()
-		 * instead of list_del() to maintain the list head tidy. Otherwise,
-		 * the framework will complain (assert) on process exit.
-		 */
-		list_for_each_entry(old, &readyqueue, list)
-		{
-			if (next->prio < old->prio)
-			{
-				temp = next;
-				next = old;
-				old = temp;
-			}
-		}
-		list_del_init(&next->list);
+	while (owner)
+	{
+		if (owner == p)
+			return true;
+		if (!owner->waiting_for)
+			return false;
+		owner = owner->waiting_for->owner;
 	}
-	/* Return the next process to run */
-	return next;
+	return false;
 }
 
-//이함수는 acquire가 발생할때!
-bool pip_acquire(int resource_id)
+bool pip_acquire(int resource_id, enum resource_mode mode)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner)
+	if (resource_available(r, mode))
 	{
 		/* This resource is not owned by any one. Take it! */
 		//아무도 리소스를 갖고 있지 않다면 owner가 되겠지?
 		//current가 owner가 된다.
-		r->owner = current;
+		resource_take(r, mode);
+		if (r->owner == current)
+			list_add_tail(&r->held_list, &current->held);
 
 		return true;
 	}
 	else
 	{
 		//resource의 owner가 존재하는 경우
-		if (r->owner->pid != current->pid)
+		if (r->owner != current)
 		{
 			//owner가 존재하긴 하는데 current가 그 owner가 아니라면?
 			//만약 누군가 리소스를 갖고있다면 이녀석은 waitqueue로 들어가고 current가 바뀌어야 맞겠지?
@@ -1188,16 +1496,17 @@ bool pip_acquire(int resource_id)
 
 			/* Update the current process state */
 
-			current->status = PROCESS_WAIT;
+			resource_wait(r, mode);
 
 			/** And append wait to waitqueue 
 	 * resource를 가지고 있는 놈이 끝나기전까지 이 프로세스는 ready상태로 들어있을 수 없음.
 	*/
-			list_add_tail(&current->list, &r->waitqueue);
-			if (current->prio > r->owner->prio)
-			{
-				r->owner->prio = current->prio + 1;
-			}
+			prio_wait(r, current);
+
+			if (pip_deadlocked(current))
+				report_deadlock(current);
+			else
+				pip_inherit(current);
 			/**
 	 * And return false to indicate the resource is not available.
 	 * The scheduler framework will soon call schedule() function to
@@ -1213,45 +1522,23 @@ void pip_release(int resource_id)
 {
 	//release를 해줄 때 가장 높은 priority를 가지고 있는 waitqueue를 뽑아주어야 한다.
 	struct resource *r = resources + resource_id;
+	struct resource_wakeup w;
+	struct process *waiter;
 
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
-
-	/* Un-own this resource */
-	r->owner->prio = r->owner->prio_orig;
-	r->owner = NULL;
+	/* Un-own this resource, and keep what the others still pass down */
+	list_del_init(&r->held_list);
+	resource_put(r);
+	current->prio = pip_inherited_prio(current);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue))
+	/* Let's wake up the waiters that can take it in the order of priority */
+	resource_wakeup_init(&w, r);
+	while ((waiter = prio_wake(r, &w)))
 	{
-		struct process *iterater;
-
-		struct process *waiter =
-			list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(iterater, &r->waitqueue, list)
-		{
-			//해당 resource를 wait하고 있는 것들중에 가장 Pior가 높은 것을
-			//readyqueue로 변환하기 위한 작업.
-			if (waiter->prio < iterater->prio)
-			{
-				//iterater와 temp의 값을 바꾼다.
-				waiter = iterater;
-			}
-		}
-
 		/**
 		 * Ensure the waiter is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
-
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
 		//release를 하니까 프로세스의 상태를 다시 레디로 바꾸어주는 것.
@@ -1259,17 +1546,957 @@ void pip_release(int resource_id)
 		 * Put the waiter process into ready queue. The framework will
 		 * do the rest.
 		 */
-		list_add_tail(&waiter->list, &readyqueue);
+		rq_enqueue(this_rq(), waiter);
 		//wait하던게 readyqueue로 넘어오면서 다시 스케쥴링이 되게끔!!
 	}
 }
 
-struct scheduler pip_scheduler = {
+const struct scheduler pip_scheduler = {
 	.name = "Priority + PIP Protocol",
 	.acquire = pip_acquire,
 	.release = pip_release,
-	.schedule = pip_schedule
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.forked = prio_forked,
+	.detach = prio_detach,
+	.attach = prio_forked,
+	.extend = prio_extend,
+	.schedule = prio_schedule
 	/**
 	 * Ditto
 	 */
 };
+
+/***********************************************************************
+ * Completely fair scheduler
+ ***********************************************************************/
+/**
+ * Load weights for nice -20 to 19, taken from the Linux kernel. Each nice
+ * level gives about 10% more (or less) CPU time than the next one.
+ */
+static const unsigned int cfs_nice_to_weight[40] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+};
+
+#define NICE_0_LOAD 1024
+
+/* Virtual runtime of a tick for a nice-0 process */
+#define CFS_TICK_VRUNTIME 1000000ULL
+
+/**
+ * Run queue of CFS. Ready processes are sorted by @vruntime in
+ * @tasks_timeline, and the leftmost one is cached to pick next in O(1).
+ */
+struct cfs_rq
+{
+	struct rb_root_cached tasks_timeline;
+	unsigned long long min_vruntime; /* Monotonic lower bound of @vruntime */
+};
+
+static inline struct cfs_rq *this_cfs_rq(void)
+{
+	return this_cpu->private;
+}
+
+/**
+ * Map @prio to the weight of nice value; MAX_PRIO to nice -20 and 0 to 19
+ */
+static inline unsigned int cfs_weight(unsigned int prio)
+{
+	if (prio > MAX_PRIO)
+		prio = MAX_PRIO;
+
+	return cfs_nice_to_weight[39 - prio * 39 / MAX_PRIO];
+}
+
+static inline unsigned long long cfs_delta(struct process *p)
+{
+	return CFS_TICK_VRUNTIME * NICE_0_LOAD / p->weight;
+}
+
+static void cfs_enqueue(struct cfs_rq *cfs_rq, struct process *p)
+{
+	struct rb_node **link = &cfs_rq->tasks_timeline.rb_root.rb_node;
+	struct rb_node *parent = NULL;
+	bool leftmost = true;
+
+	/**
+	 * Processes with the same vruntime go to the right, so they are switched
+	 * in the round-robin way
+	 */
+	while (*link)
+	{
+		parent = *link;
+		if (p->vruntime < rb_entry(parent, struct process, run_node)->vruntime)
+		{
+			link = &parent->rb_left;
+		}
+		else
+		{
+			link = &parent->rb_right;
+			leftmost = false;
+		}
+	}
+
+	rb_link_node(&p->run_node, parent, link);
+	rb_insert_color_cached(&p->run_node, &cfs_rq->tasks_timeline, leftmost);
+}
+
+static struct process *cfs_dequeue_first(struct cfs_rq *cfs_rq)
+{
+	struct rb_node *node = rb_first_cached(&cfs_rq->tasks_timeline);
+
+	if (!node)
+		return NULL;
+
+	rb_erase_cached(node, &cfs_rq->tasks_timeline);
+	return rb_entry(node, struct process, run_node);
+}
+
+/**
+ * Move processes in @readyqueue (i.e., forked, woken up, or migrated) into
+ * the run queue. They start no earlier than @min_vruntime so that a
+ * process cannot monopolize the CPU after sleeping for a long time.
+ */
+static void cfs_enqueue_ready(struct cfs_rq *cfs_rq)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list)
+	{
+		list_del_init(&p->list);
+
+		if (p->vruntime < cfs_rq->min_vruntime)
+			p->vruntime = cfs_rq->min_vruntime;
+		cfs_enqueue(cfs_rq, p);
+	}
+}
+
+static int cfs_initialize(void)
+{
+	struct cfs_rq *cfs_rq = malloc(sizeof(*cfs_rq));
+
+	if (!cfs_rq)
+		return -1;
+
+	cfs_rq->tasks_timeline = RB_ROOT_CACHED;
+	cfs_rq->min_vruntime = 0;
+	this_cpu->private = cfs_rq;
+	return 0;
+}
+
+static void cfs_finalize(void)
+{
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
+
+static void cfs_forked(struct process *p)
+{
+	p->weight = cfs_weight(p->prio);
+	p->vruntime = 0;
+}
+
+static struct process *cfs_schedule(void)
+{
+	struct cfs_rq *cfs_rq = this_cfs_rq();
+	struct process *next;
+
+	cfs_enqueue_ready(cfs_rq);
+
+	if (!current || current->status == PROCESS_WAIT)
+	{
+		goto pick_next;
+	}
+
+	/* Charge the tick that the current has run for */
+	current->vruntime += cfs_delta(current);
+
+	if (current->age < current->lifespan)
+	{
+		cfs_enqueue(cfs_rq, current);
+	}
+
+pick_next:
+	/* Pick the process that has run the least */
+	next = cfs_dequeue_first(cfs_rq);
+
+	if (next && next->vruntime > cfs_rq->min_vruntime)
+		cfs_rq->min_vruntime = next->vruntime;
+
+	return next;
+}
+
+/**
+ * The current keeps running while its vruntime is less than that of the
+ * leftmost process
+ */
+static unsigned int cfs_extend(unsigned int nr_ticks)
+{
+	struct cfs_rq *cfs_rq = this_cfs_rq();
+	struct rb_node *node;
+	unsigned long long delta = cfs_delta(current);
+
+	cfs_enqueue_ready(cfs_rq);
+
+	node = rb_first_cached(&cfs_rq->tasks_timeline);
+	if (node)
+	{
+		unsigned long long leftmost = rb_entry(node, struct process, run_node)->vruntime;
+
+		if (current->vruntime + delta >= leftmost)
+			return 0;
+
+		if ((leftmost - current->vruntime - 1) / delta < nr_ticks)
+			nr_ticks = (leftmost - current->vruntime - 1) / delta;
+	}
+
+	current->vruntime += delta * nr_ticks;
+	if (current->vruntime > cfs_rq->min_vruntime)
+		cfs_rq->min_vruntime = current->vruntime;
+
+	return nr_ticks;
+}
+
+/**
+ * Migrate vruntime relative to @min_vruntime of the run queue
+ */
+static struct process *cfs_detach(void)
+{
+	struct cfs_rq *cfs_rq = this_cfs_rq();
+	struct process *p;
+
+	cfs_enqueue_ready(cfs_rq);
+
+	p = cfs_dequeue_first(cfs_rq);
+	if (p)
+		p->vruntime -= cfs_rq->min_vruntime;
+
+	return p;
+}
+
+static void cfs_attach(struct process *p)
+{
+	struct cfs_rq *cfs_rq = this_cfs_rq();
+
+	list_del_init(&p->list);
+
+	p->vruntime += cfs_rq->min_vruntime;
+	cfs_enqueue(cfs_rq, p);
+}
+
+const struct scheduler cfs_scheduler = {
+	.name = "Completely Fair",
+	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
+	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = cfs_initialize,
+	.finalize = cfs_finalize,
+	.forked = cfs_forked,
+	.schedule = cfs_schedule,
+	.extend = cfs_extend,
+	.detach = cfs_detach,
+	.attach = cfs_attach,
+};
+
+/***********************************************************************
+ * Multi-level feedback queue scheduler
+ *
+ * A process starts at the top level and goes down by one level when it
+ * uses up the time quantum of its level. Processes at a level run in the
+ * round-robin way, and a process at a higher level preempts the current.
+ * All processes are boosted to the top every @boost ticks not to starve.
+ ***********************************************************************/
+static const unsigned int mlfq_default_quantum[] = {1, 2, 4};
+
+#define MLFQ_DEFAULT_BOOST 50
+
+/**
+ * Run queue of MLFQ. The levels having a ready process are marked in
+ * @bitmap, so the highest one is found in O(1).
+ *
+ * A boost is done lazily. @epoch is the number of boosts so far, and the
+ * ready processes are spliced into the top level in O(@nr_levels) when it
+ * changes. The others (i.e., running or blocked) have @p->epoch left
+ * behind, and are reset to the top when they come back to the run queue.
+ */
+struct mlfq_rq
+{
+	unsigned int bitmap;
+	struct list_head queues[MLFQ_MAX_LEVELS];
+	unsigned long long epoch;
+
+	unsigned int nr_levels;
+	unsigned int quantum[MLFQ_MAX_LEVELS];
+	unsigned int boost;
+};
+
+static inline struct mlfq_rq *this_mlfq_rq(void)
+{
+	return this_cpu->private;
+}
+
+static inline unsigned long long mlfq_epoch(struct mlfq_rq *rq)
+{
+	return rq->boost ? ticks / rq->boost : 0;
+}
+
+/**
+ * Reset @p to the top if it has missed a boost
+ */
+static inline void mlfq_refresh(struct mlfq_rq *rq, struct process *p)
+{
+	if (p->epoch == rq->epoch)
+		return;
+
+	p->level = 0;
+	p->slice = 0;
+	p->epoch = rq->epoch;
+}
+
+static void mlfq_boost(struct mlfq_rq *rq)
+{
+	unsigned long long epoch = mlfq_epoch(rq);
+
+	if (epoch == rq->epoch)
+		return;
+
+	for (unsigned int i = 1; i < rq->nr_levels; i++)
+	{
+		list_splice_tail_init(&rq->queues[i], &rq->queues[0]);
+	}
+	if (rq->bitmap)
+		rq->bitmap = 1;
+	rq->epoch = epoch;
+}
+
+static inline void mlfq_enqueue(struct mlfq_rq *rq, struct process *p, bool head)
+{
+	if (head)
+		list_add(&p->list, &rq->queues[p->level]);
+	else
+		list_add_tail(&p->list, &rq->queues[p->level]);
+	rq->bitmap |= 1u << p->level;
+}
+
+static struct process *mlfq_dequeue_first(struct mlfq_rq *rq)
+{
+	struct process *p;
+	unsigned int level;
+
+	if (!rq->bitmap)
+		return NULL;
+
+	level = __builtin_ctz(rq->bitmap);
+	p = list_first_entry(&rq->queues[level], struct process, list);
+	list_del_init(&p->list);
+	if (list_empty(&rq->queues[level]))
+		rq->bitmap &= ~(1u << level);
+
+	/* It might be spliced into the top by a boost */
+	mlfq_refresh(rq, p);
+	return p;
+}
+
+/**
+ * Move processes in @readyqueue (i.e., forked, woken up, or migrated) into
+ * the run queue. A woken up process stays at its level with the rest of
+ * its time quantum.
+ */
+static void mlfq_enqueue_ready(struct mlfq_rq *rq)
+{
+	struct process *p, *tmp;
+
+	mlfq_boost(rq);
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list)
+	{
+		list_del_init(&p->list);
+
+		mlfq_refresh(rq, p);
+		mlfq_enqueue(rq, p, false);
+	}
+}
+
+static int mlfq_initialize(void)
+{
+	struct mlfq_rq *rq = malloc(sizeof(*rq));
+	struct sched_config *config = &this_sim->config;
+
+	if (!rq)
+		return -1;
+
+	rq->bitmap = 0;
+	for (unsigned int i = 0; i < MLFQ_MAX_LEVELS; i++)
+	{
+		INIT_LIST_HEAD(&rq->queues[i]);
+	}
+
+	if (config->flags & CONFIG_MLFQ_QUANTUM)
+	{
+		rq->nr_levels = config->mlfq.nr_levels;
+		for (unsigned int i = 0; i < rq->nr_levels; i++)
+		{
+			rq->quantum[i] = config->mlfq.quantum[i];
+		}
+	}
+	else
+	{
+		rq->nr_levels = sizeof(mlfq_default_quantum) / sizeof(mlfq_default_quantum[0]);
+		for (unsigned int i = 0; i < rq->nr_levels; i++)
+		{
+			rq->quantum[i] = mlfq_default_quantum[i];
+		}
+	}
+	rq->boost = (config->flags & CONFIG_MLFQ_BOOST) ? config->mlfq.boost : MLFQ_DEFAULT_BOOST;
+	rq->epoch = mlfq_epoch(rq);
+
+	this_cpu->private = rq;
+	return 0;
+}
+
+static void mlfq_finalize(void)
+{
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
+
+static void mlfq_forked(struct process *p)
+{
+	p->level = 0;
+	p->slice = 0;
+	p->epoch = this_mlfq_rq()->epoch;
+}
+
+static struct process *mlfq_schedule(void)
+{
+	struct mlfq_rq *rq = this_mlfq_rq();
+
+	mlfq_enqueue_ready(rq);
+
+	if (!current || current->status == PROCESS_WAIT)
+	{
+		goto pick_next;
+	}
+
+	if (current->age < current->lifespan)
+	{
+		mlfq_refresh(rq, current);
+
+		/* Charge the tick that the current has run for */
+		if (++current->slice >= rq->quantum[current->level])
+		{
+			/* Used up the time quantum. Demote it */
+			if (current->level < rq->nr_levels - 1)
+				current->level++;
+			current->slice = 0;
+			mlfq_enqueue(rq, current, false);
+		}
+		else if (rq->bitmap & ((1u << current->level) - 1))
+		{
+			/* Preempted by a higher level. Resume it first at its level */
+			mlfq_enqueue(rq, current, true);
+		}
+		else
+		{
+			return current;
+		}
+	}
+
+pick_next:
+	return mlfq_dequeue_first(rq);
+}
+
+/**
+ * The current keeps running until it uses up its time quantum or the next
+ * boost comes, unless a process is ready at a higher level
+ */
+static unsigned int mlfq_extend(unsigned int nr_ticks)
+{
+	struct mlfq_rq *rq = this_mlfq_rq();
+	unsigned int remaining;
+
+	mlfq_enqueue_ready(rq);
+	mlfq_refresh(rq, current);
+
+	if (rq->bitmap & ((1u << current->level) - 1))
+		return 0;
+
+	remaining = rq->quantum[current->level] - current->slice - 1;
+	if (remaining < nr_ticks)
+		nr_ticks = remaining;
+
+	if (rq->boost && (rq->epoch + 1) * rq->boost - ticks < nr_ticks)
+		nr_ticks = (rq->epoch + 1) * rq->boost - ticks;
+
+	current->slice += nr_ticks;
+	return nr_ticks;
+}
+
+static struct process *mlfq_detach(void)
+{
+	struct mlfq_rq *rq = this_mlfq_rq();
+
+	mlfq_enqueue_ready(rq);
+
+	return mlfq_dequeue_first(rq);
+}
+
+static void mlfq_attach(struct process *p)
+{
+	struct mlfq_rq *rq = this_mlfq_rq();
+
+	list_del_init(&p->list);
+
+	mlfq_refresh(rq, p);
+	mlfq_enqueue(rq, p, false);
+}
+
+const struct scheduler mlfq_scheduler = {
+	.name = "Multi-level Feedback Queue",
+	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
+	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = mlfq_initialize,
+	.finalize = mlfq_finalize,
+	.forked = mlfq_forked,
+	.schedule = mlfq_schedule,
+	.extend = mlfq_extend,
+	.detach = mlfq_detach,
+	.attach = mlfq_attach,
+};
+
+/***********************************************************************
+ * Proportional-share schedulers
+ *
+ * A process gets the CPU in proportion to its tickets, which are its
+ * priority plus one so that the processes with priority 0 are not starved.
+ ***********************************************************************/
+static inline unsigned int ps_tickets(unsigned int prio)
+{
+	return (prio > MAX_PRIO ? MAX_PRIO : prio) + 1;
+}
+
+/***********************************************************************
+ * Stride scheduler
+ *
+ * A process advances its pass by its stride, which is inversely
+ * proportional to its tickets, for each tick it runs, and the one with the
+ * smallest pass runs next. The ready processes are in a min-heap on the
+ * pass, and those with the same pass run in the order they became ready.
+ ***********************************************************************/
+#define STRIDE_ONE (1ULL << 20)
+
+struct stride_rq
+{
+	struct heap heap;
+	unsigned long long seq;
+	unsigned long long pass; /* Monotonic lower bound of the pass */
+};
+
+static inline struct stride_rq *this_stride_rq(void)
+{
+	return this_cpu->private;
+}
+
+static inline unsigned long long stride_of(struct process *p)
+{
+	return STRIDE_ONE / p->tickets;
+}
+
+static bool stride_before(struct process *p, struct process *q)
+{
+	if (p->pass != q->pass)
+		return p->pass < q->pass;
+	return p->seq < q->seq;
+}
+
+static void stride_enqueue(struct stride_rq *rq, struct process *p)
+{
+	p->seq = ++rq->seq;
+	heap_push(&rq->heap, p);
+}
+
+/**
+ * Move processes in @readyqueue into the heap. They start no earlier than
+ * @pass of the run queue not to take the CPU for a long time after sleeping
+ */
+static void stride_enqueue_ready(struct stride_rq *rq)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list)
+	{
+		list_del_init(&p->list);
+
+		if (p->pass < rq->pass)
+			p->pass = rq->pass;
+		stride_enqueue(rq, p);
+	}
+}
+
+static int stride_initialize(void)
+{
+	struct stride_rq *rq = malloc(sizeof(*rq));
+
+	if (!rq)
+		return -1;
+
+	heap_init(&rq->heap, stride_before);
+	rq->seq = 0;
+	rq->pass = 0;
+
+	this_cpu->private = rq;
+	return 0;
+}
+
+static void stride_finalize(void)
+{
+	heap_fini(&this_stride_rq()->heap);
+	free(this_cpu->private);
+	this_cpu->private = NULL;
+}
+
+static void stride_forked(struct process *p)
+{
+	p->tickets = ps_tickets(p->prio);
+	p->pass = 0;
+}
+
+static struct process *stride_schedule(void)
+{
+	struct stride_rq *rq = this_stride_rq();
+	struct process *next;
+
+	stride_enqueue_ready(rq);
+
+	if (!current || current->status == PROCESS_WAIT)
+	{
+		goto pick_next;
+	}
+
+	/* Charge the tick that the current has run for */
+	current->pass += stride_of(current);
+
+	if (current->age < current->lifespan)
+	{
+		stride_enqueue(rq, current);
+	}
+
+pick_next:
+	next = heap_pop(&rq->heap);
+
+	if (next && next->pass > rq->pass)
+		rq->pass = next->pass;
+
+	return next;
+}
+
+/**
+ * The current keeps running while its pass is less than the smallest one
+ * in the heap
+ */
+static unsigned int stride_extend(unsigned int nr_ticks)
+{
+	struct stride_rq *rq = this_stride_rq();
+	struct process *next;
+	unsigned long long stride = stride_of(current);
+
+	stride_enqueue_ready(rq);
+
+	next = heap_top(&rq->heap);
+	if (next)
+	{
+		if (current->pass + stride >= next->pass)
+			return 0;
+
+		if ((next->pass - current->pass - 1) / stride < nr_ticks)
+			nr_ticks = (next->pass - current->pass - 1) / stride;
+	}
+
+	current->pass += stride * nr_ticks;
+	if (current->pass > rq->pass)
+		rq->pass = current->pass;
+
+	return nr_ticks;
+}
+
+/**
+ * Migrate the pass relative to @pass of the run queue
+ */
+static struct process *stride_detach(void)
+{
+	struct stride_rq *rq = this_stride_rq();
+	struct process *p;
+
+	stride_enqueue_ready(rq);
+
+	p = heap_pop(&rq->heap);
+	if (p)
+		p->pass -= p->pass < rq->pass ? p->pass : rq->pass;
+
+	return p;
+}
+
+static void stride_attach(struct process *p)
+{
+	struct stride_rq *rq = this_stride_rq();
+
+	list_del_init(&p->list);
+
+	p->pass += rq->pass;
+	stride_enqueue(rq, p);
+}
+
+const struct scheduler stride_scheduler = {
+	.name = "Stride",
+	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
+	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = stride_initialize,
+	.finalize = stride_finalize,
+	.forked = stride_forked,
+	.schedule = stride_schedule,
+	.extend = stride_extend,
+	.detach = stride_detach,
+	.attach = stride_attach,
+};
+
+/***********************************************************************
+ * Lottery scheduler
+ *
+ * The ready processes hold slots in a pool, and a Fenwick tree over the
+ * slots sums up their tickets. So, the winner of a draw is found by
+ * descending the tree in O(log n) rather than walking the ready processes.
+ * The slots of the processes leaving the pool are reused. Each CPU has its
+ * own random number generator with a fixed seed, so the simulation is
+ * reproducible.
+ ***********************************************************************/
+#define LOTTERY_SEED 0x9e3779b97f4a7c15ULL
+
+struct lottery_rq
+{
+	unsigned long long *tree;  /* 1-based Fenwick tree of the tickets */
+	struct process **procs;	   /* Process in each slot. NULL if free */
+	unsigned int *free_slots;  /* Stack of free slots below @nr_slots */
+	unsigned int nr_free;
+	unsigned int nr_slots;	   /* Slots ever used */
+	unsigned int capacity;	   /* Power of two */
+	unsigned int nr_procs;
+
+	unsigned long long state; /* State of xorshift64* */
+};
+
+static inline struct lottery_rq *this_lottery_rq(void)
+{
+	return this_cpu->private;
+}
+
+static unsigned long long lottery_random(struct lottery_rq *rq)
+{
+	rq->state ^= rq->state >> 12;
+	rq->state ^= rq->state << 25;
+	rq->state ^= rq->state >> 27;
+	return rq->state * 0x2545f4914f6cdd1dULL;
+}
+
+static void lottery_update(struct lottery_rq *rq, unsigned int slot, long long delta)
+{
+	for (unsigned int i = slot + 1; i <= rq->capacity; i += i & -i)
+	{
+		rq->tree[i] += delta;
+	}
+}
+
+/**
+ * Double the slots, and build the tree again in O(n)
+ */
+static void lottery_grow(struct lottery_rq *rq)
+{
+	unsigned int capacity = rq->capacity ? rq->capacity * 2 : 64;
+
+	rq->procs = realloc(rq->procs, sizeof(*rq->procs) * capacity);
+	rq->free_slots = realloc(rq->free_slots, sizeof(*rq->free_slots) * capacity);
+	free(rq->tree);
+	rq->tree = calloc(capacity + 1, sizeof(*rq->tree));
+	assert(rq->procs && rq->free_slots && rq->tree);
+
+	for (unsigned int i = rq->capacity; i < capacity; i++)
+	{
+		rq->procs[i] = NULL;
+	}
+	rq->capacity = capacity;
+
+	for (unsigned int i = 1; i <= capacity; i++)
+	{
+		if (rq->procs[i - 1])
+			rq->tree[i] += rq->procs[i - 1]->tickets;
+		if (i + (i & -i) <= capacity)
+			rq->tree[i + (i & -i)] += rq->tree[i];
+	}
+}
+
+static void lottery_enqueue(struct lottery_rq *rq, struct process *p)
+{
+	if (rq->nr_free)
+	{
+		p->slot = rq->free_slots[--rq->nr_free];
+	}
+	else
+	{
+		if (rq->nr_slots == rq->capacity)
+			lottery_grow(rq);
+		p->slot = rq->nr_slots++;
+	}
+
+	rq->procs[p->slot] = p;
+	lottery_update(rq, p->slot, p->tickets);
+	rq->nr_procs++;
+}
+
+static void lottery_dequeue(struct lottery_rq *rq, struct process *p)
+{
+	rq->procs[p->slot] = NULL;
+	lottery_update(rq, p->slot, -(long long)p->tickets);
+	rq->free_slots[rq->nr_free++] = p->slot;
+	rq->nr_procs--;
+}
+
+/**
+ * Draw the winning process and take it out of the pool
+ */
+static struct process *lottery_draw(struct lottery_rq *rq)
+{
+	unsigned long long winner;
+	unsigned int pos = 0;
+	struct process *p;
+
+	if (!rq->nr_procs)
+		return NULL;
+
+	/* The root of the tree holds the total tickets */
+	winner = lottery_random(rq) % rq->tree[rq->capacity];
+
+	for (unsigned int step = rq->capacity; step; step >>= 1)
+	{
+		if (pos + step <= rq->capacity && rq->tree[pos + step] <= winner)
+		{
+			pos += step;
+			winner -= rq->tree[pos];
+		}
+	}
+
+	p = rq->procs[pos];
+	assert(p);
+	lottery_dequeue(rq, p);
+	return p;
+}
+
+static void lottery_enqueue_ready(struct lottery_rq *rq)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list)
+	{
+		list_del_init(&p->list);
+		lottery_enqueue(rq, p);
+	}
+}
+
+static int lottery_initialize(void)
+{
+	struct lottery_rq *rq = calloc(1, sizeof(*rq));
+
+	if (!rq)
+		return -1;
+
+	rq->state = LOTTERY_SEED * (this_cpu->id + 1);
+	lottery_grow(rq);
+
+	this_cpu->private = rq;
+	return 0;
+}
+
+static void lottery_finalize(void)
+{
+	struct lottery_rq *rq = this_lottery_rq();
+
+	free(rq->tree);
+	free(rq->procs);
+	free(rq->free_slots);
+	free(rq);
+	this_cpu->private = NULL;
+}
+
+static void lottery_forked(struct process *p)
+{
+	p->tickets = ps_tickets(p->prio);
+}
+
+static struct process *lottery_schedule(void)
+{
+	struct lottery_rq *rq = this_lottery_rq();
+
+	lottery_enqueue_ready(rq);
+
+	if (!current || current->status == PROCESS_WAIT)
+	{
+		goto pick_next;
+	}
+
+	if (current->age < current->lifespan)
+	{
+		/* No need to draw when the current is the only one */
+		if (!rq->nr_procs)
+			return current;
+
+		lottery_enqueue(rq, current);
+	}
+
+pick_next:
+	return lottery_draw(rq);
+}
+
+/**
+ * A draw is held on every tick unless the current is the only one to run
+ */
+static unsigned int lottery_extend(unsigned int nr_ticks)
+{
+	struct lottery_rq *rq = this_lottery_rq();
+
+	lottery_enqueue_ready(rq);
+
+	return rq->nr_procs ? 0 : nr_ticks;
+}
+
+static struct process *lottery_detach(void)
+{
+	struct lottery_rq *rq = this_lottery_rq();
+
+	lottery_enqueue_ready(rq);
+
+	return lottery_draw(rq);
+}
+
+static void lottery_attach(struct process *p)
+{
+	list_del_init(&p->list);
+	lottery_enqueue(this_lottery_rq(), p);
+}
+
+const struct scheduler lottery_scheduler = {
+	.name = "Lottery",
+	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
+	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = lottery_initialize,
+	.finalize = lottery_finalize,
+	.forked = lottery_forked,
+	.schedule = lottery_schedule,
+	.extend = lottery_extend,
+	.detach = lottery_detach,
+	.attach = lottery_attach,
+};
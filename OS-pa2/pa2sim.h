@@ -0,0 +1,59 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PA2SIM_H__
+#define __PA2SIM_H__
+
+/**
+ * The names that pa2.c and sched.c have used for the simulator state from
+ * when it was kept in global variables. They refer to the fields of @this_sim and
+ * rewrite these identifiers throughout the including file, so include this
+ * only in those two; the other files use this_sim->... instead.
+ */
+#include "simulation.h"
+
+/**
+ * The process that is currently running
+ */
+#define current (this_sim->current)
+
+/**
+ * List head to hold the processes ready to run
+ */
+#define readyqueue (this_sim->readyqueue)
+
+/**
+ * The CPU being scheduled and the number of CPUs. See cpu.h
+ */
+#define this_cpu (this_sim->this_cpu)
+#define nr_cpus (this_sim->nr_cpus)
+
+/**
+ * Monotonically increasing ticks
+ */
+#define ticks (this_sim->ticks)
+
+/**
+ * Resources in the system. See resource.h
+ */
+#define resources (this_sim->resources)
+#define nr_resources (this_sim->nr_resources)
+
+/**
+ * Quiet mode. True if the program was started with -q option
+ */
+#define quiet (this_sim->quiet)
+
+#endif
@@ -0,0 +1,344 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/* syscall() and the scheduling calls on thread ids are not in POSIX */
+#undef _POSIX_C_SOURCE
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+#include "process.h"
+#include "pmutex.h"
+
+static __thread pid_t __tid = 0;
+static __thread unsigned int __prio = 0;
+
+/**
+ * The priority this thread runs at, which is @__prio or the ceiling it is
+ * raised to. Threads not given a real-time priority with pmutex_setprio()
+ * are not raised
+ */
+static __thread unsigned int __running_prio = 0;
+static __thread bool __realtime = false;
+
+/* PMUTEX_CEILING mutexes that this thread holds, the latest first */
+static __thread struct pmutex *__held = NULL;
+
+static inline pid_t __gettid(void)
+{
+	if (!__tid)
+		__tid = syscall(SYS_gettid);
+	return __tid;
+}
+
+static inline unsigned long long __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline long __futex(uint32_t *word, int op, uint32_t val)
+{
+	return syscall(SYS_futex, word, op, val, NULL, NULL, 0);
+}
+
+static inline bool __cmpxchg(uint32_t *word, uint32_t old, uint32_t new)
+{
+	return __atomic_compare_exchange_n(word, &old, new, false,
+									   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t __owner(struct pmutex *m)
+{
+	return __atomic_load_n(&m->word, __ATOMIC_RELAXED) & FUTEX_TID_MASK;
+}
+
+/**
+ * Lock and unlock the PI futex at @word. Return the number of system calls
+ * made, or -errno on failure
+ */
+static int __lock_pi(uint32_t *word)
+{
+	int nr_syscalls = 0;
+
+	if (__cmpxchg(word, 0, __gettid()))
+		return 0;
+
+	/* The kernel retries on its own unless the owner is going away */
+	while (++nr_syscalls, __futex(word, FUTEX_LOCK_PI_PRIVATE, 0))
+	{
+		if (errno != EAGAIN && errno != EINTR)
+			return -errno;
+	}
+	return nr_syscalls;
+}
+
+static int __unlock_pi(uint32_t *word)
+{
+	if (__atomic_compare_exchange_n(word, &(uint32_t){__gettid()}, 0, false,
+									__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		return 0;
+
+	/* The kernel hands the futex to the highest waiter */
+	__futex(word, FUTEX_UNLOCK_PI_PRIVATE, 0);
+	return 1;
+}
+
+static inline int __sched_prio(unsigned int prio)
+{
+	int max = sched_get_priority_max(SCHED_FIFO);
+	int p = sched_get_priority_min(SCHED_FIFO) + prio;
+
+	return p < max ? p : max;
+}
+
+/**
+ * Make this thread run at @prio. Only the thread itself changes its priority,
+ * so no one races with it
+ */
+static void __run_at(unsigned int prio)
+{
+	struct sched_param param = {
+		.sched_priority = __sched_prio(prio),
+	};
+
+	if (prio == __running_prio || !__realtime)
+		return;
+
+	if (!pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+		__running_prio = prio;
+}
+
+/**
+ * The priority this thread should run at; its own one or the highest ceiling
+ * of the mutexes that it holds
+ */
+static unsigned int __ceiling_prio(void)
+{
+	unsigned int prio = __prio;
+
+	for (struct pmutex *m = __held; m; m = m->next_held)
+	{
+		if (m->ceiling > prio)
+			prio = m->ceiling;
+	}
+	return prio;
+}
+
+/**
+ * Wait for @m with FUTEX_WAIT until it is ours. Return the number of system
+ * calls made
+ */
+static int __lock_wait(struct pmutex *m)
+{
+	pid_t tid = __gettid();
+	int nr_syscalls = 0;
+
+	while (true)
+	{
+		uint32_t word = 0;
+
+		/* Others may be waiting as well, so take it as contended */
+		if (__atomic_compare_exchange_n(&m->word, &word, tid | FUTEX_WAITERS, false,
+										__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return nr_syscalls;
+
+		/* Tell the owner to wake us up on release */
+		if (!(word & FUTEX_WAITERS) && !__cmpxchg(&m->word, word, word | FUTEX_WAITERS))
+			continue;
+		word |= FUTEX_WAITERS;
+
+		__futex(&m->word, FUTEX_WAIT_PRIVATE, word);
+		nr_syscalls++;
+	}
+}
+
+static int __lock_slow(struct pmutex *m)
+{
+	unsigned long long started_at = __now();
+	unsigned long long waited;
+	int nr_syscalls;
+
+	if (__owner(m) == __gettid())
+		return EDEADLK;
+
+	if (m->protocol == PMUTEX_INHERIT)
+		nr_syscalls = __lock_pi(&m->word);
+	else
+		nr_syscalls = __lock_wait(m);
+
+	if (nr_syscalls < 0)
+		return -nr_syscalls;
+
+	/* It is ours now, so update the statistics without a race */
+	waited = __now() - started_at;
+	m->stats.nr_contended++;
+	m->stats.nr_syscalls += nr_syscalls;
+	m->stats.wait_ns += waited;
+	if (waited > m->stats.max_wait_ns)
+		m->stats.max_wait_ns = waited;
+	return 0;
+}
+
+/**
+ * Raise this thread to the ceiling of @m before it tries to take @m, so that
+ * no thread that may acquire @m can preempt it between taking @m and the
+ * raise. Return whether this thread is raised
+ */
+static inline bool __raise(struct pmutex *m)
+{
+	/* Mostly running at or above the ceiling already for nested ones */
+	if (m->protocol != PMUTEX_CEILING || m->ceiling <= __running_prio ||
+		!__realtime)
+		return false;
+
+	__run_at(m->ceiling);
+	return true;
+}
+
+static inline void __locked(struct pmutex *m, bool raised)
+{
+	m->stats.nr_acquires++;
+
+	if (m->protocol == PMUTEX_CEILING)
+	{
+		m->next_held = __held;
+		__held = m;
+
+		if (raised)
+			m->stats.nr_boosts++;
+	}
+}
+
+static inline void __unhold(struct pmutex *m)
+{
+	struct pmutex **pm = &__held;
+
+	/* Mostly the latest one */
+	while (*pm != m)
+		pm = &(*pm)->next_held;
+	*pm = m->next_held;
+	m->next_held = NULL;
+}
+
+void pmutex_init(struct pmutex *m, enum pmutex_protocol protocol, unsigned int ceiling)
+{
+	m->word = 0;
+	m->protocol = protocol;
+	m->ceiling = ceiling < MAX_PRIO ? ceiling : MAX_PRIO;
+	m->next_held = NULL;
+	m->stats = (struct pmutex_stats){0};
+}
+
+int pmutex_lock(struct pmutex *m)
+{
+	bool raised;
+
+	if (m->protocol == PMUTEX_CEILING && __prio > m->ceiling)
+		return EINVAL;
+
+	raised = __raise(m);
+	if (!__cmpxchg(&m->word, 0, __gettid()))
+	{
+		int ret = __lock_slow(m);
+		if (ret)
+		{
+			/* Step back down as @m is not ours */
+			if (raised)
+				__run_at(__ceiling_prio());
+			return ret;
+		}
+	}
+
+	__locked(m, raised);
+	return 0;
+}
+
+int pmutex_trylock(struct pmutex *m)
+{
+	bool raised;
+
+	if (m->protocol == PMUTEX_CEILING && __prio > m->ceiling)
+		return EINVAL;
+
+	raised = __raise(m);
+	if (!__cmpxchg(&m->word, 0, __gettid()))
+	{
+		if (raised)
+			__run_at(__ceiling_prio());
+		return EBUSY;
+	}
+
+	__locked(m, raised);
+	return 0;
+}
+
+int pmutex_unlock(struct pmutex *m)
+{
+	if (__owner(m) != __gettid())
+		return EPERM;
+
+	if (m->protocol == PMUTEX_CEILING)
+		__unhold(m);
+
+	if (m->protocol == PMUTEX_INHERIT)
+	{
+		/* Count it ahead as the mutex will not be ours after the call */
+		if ((__atomic_load_n(&m->word, __ATOMIC_RELAXED) & FUTEX_WAITERS))
+			m->stats.nr_syscalls++;
+		__unlock_pi(&m->word);
+		return 0;
+	}
+
+	if (!__atomic_compare_exchange_n(&m->word, &(uint32_t){__gettid()}, 0, false,
+									 __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+		/* There are waiters. Wake up the highest one */
+		m->stats.nr_syscalls++;
+		__atomic_store_n(&m->word, 0, __ATOMIC_RELEASE);
+		__futex(&m->word, FUTEX_WAKE_PRIVATE, 1);
+	}
+
+	/* Step down after the release so that the waiter does not wait for us */
+	if (m->protocol == PMUTEX_CEILING)
+		__run_at(__ceiling_prio());
+	return 0;
+}
+
+int pmutex_setprio(unsigned int prio)
+{
+	struct sched_param param;
+	int ret;
+
+	__prio = prio;
+	prio = __ceiling_prio();
+	param.sched_priority = __sched_prio(prio);
+
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	__realtime = !ret;
+	__running_prio = prio;
+	return ret;
+}
@@ -0,0 +1,114 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PMUTEX_H__
+#define __PMUTEX_H__
+
+#include <stdint.h>
+
+#include "types.h"
+
+/***********************************************************************
+ * Priority-aware mutex for pthreads
+ *
+ * DESCRIPTION
+ *   A futex-based mutex with the protocols of the PIP and PCP schedulers
+ *   in pa2.c for real threads. The priorities are in the scale of
+ *   struct process (0 to MAX_PRIO, the larger the higher), and a thread
+ *   with priority p runs at SCHED_FIFO priority p + 1.
+ *
+ *   The lock word holds the thread id of the owner, or 0 when the mutex is
+ *   free. So, acquiring a free mutex and releasing one without waiters are
+ *   a compare-and-swap on the word and make no system call. Otherwise the
+ *   slow path asks the kernel for help;
+ *
+ *   - PMUTEX_INHERIT goes to FUTEX_LOCK_PI and FUTEX_UNLOCK_PI. The kernel
+ *     raises the owner to the priority of the highest waiter, passes it
+ *     down the chain of owners, hands the mutex to the highest waiter on
+ *     release, and fails with EDEADLK if the chain comes back to the caller.
+ *   - PMUTEX_CEILING raises the caller to @ceiling before it tries to take
+ *     the mutex, as PTHREAD_PRIO_PROTECT does, and puts it back on release
+ *     or when the mutex is not taken. So no thread that may acquire the
+ *     mutex can preempt the owner once it holds the mutex, and on one
+ *     CPU a thread is blocked at most once and never deadlocks. The
+ *     raising costs a system call only when the thread runs below the
+ *     ceiling; taking a nested mutex with a lower ceiling is still only a
+ *     compare-and-swap. The waiters sleep with FUTEX_WAIT, which wakes up
+ *     the highest one first.
+ *   - PMUTEX_NONE is a plain futex mutex to compare against.
+ */
+enum pmutex_protocol
+{
+	PMUTEX_NONE,
+	PMUTEX_INHERIT,
+	PMUTEX_CEILING,
+};
+
+/**
+ * Contention statistics of a mutex. The owner updates them while holding the
+ * mutex, so read them when no thread uses the mutex
+ */
+struct pmutex_stats
+{
+	unsigned long long nr_acquires;
+	unsigned long long nr_contended; /* # of acquisitions that took the slow path */
+	unsigned long long nr_syscalls;	 /* # of futex calls to acquire and release */
+	unsigned long long nr_boosts;	 /* # of acquisitions that raised the caller to the ceiling */
+	unsigned long long wait_ns;		 /* Time spent in the slow path to acquire */
+	unsigned long long max_wait_ns;
+};
+
+struct pmutex
+{
+	uint32_t word; /* Thread id of the owner | FUTEX_WAITERS. 0 if free */
+	enum pmutex_protocol protocol;
+	unsigned int ceiling;
+
+	struct pmutex *next_held; /* Next PMUTEX_CEILING mutex the owner holds */
+
+	struct pmutex_stats stats;
+};
+
+/**
+ * Initialize @m with @protocol. @ceiling is the highest priority of the
+ * threads that will acquire @m, and matters only for PMUTEX_CEILING
+ */
+void pmutex_init(struct pmutex *m, enum pmutex_protocol protocol, unsigned int ceiling);
+
+/**
+ * Acquire @m. Return 0 on success, EDEADLK if the caller already owns it or
+ * waiting for it would deadlock, or EINVAL if the caller's priority is above
+ * the ceiling of @m
+ */
+int pmutex_lock(struct pmutex *m);
+
+/**
+ * Acquire @m if it is free. Return 0 on success or EBUSY
+ */
+int pmutex_trylock(struct pmutex *m);
+
+/**
+ * Release @m. Return 0 on success or EPERM if the caller does not own it
+ */
+int pmutex_unlock(struct pmutex *m);
+
+/**
+ * Make the calling thread run with @prio. Return 0 on success or the error
+ * of pthread_setschedparam() if the thread cannot run with a real-time
+ * priority, in which case @prio is still checked against the ceilings
+ */
+int pmutex_setprio(unsigned int prio);
+
+#endif
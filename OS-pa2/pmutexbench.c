@@ -0,0 +1,473 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/* CPU affinity and the thread CPU clock are not in POSIX */
+#undef _POSIX_C_SOURCE
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "resource.h"
+#include "script.h"
+#include "pmutex.h"
+
+/***********************************************************************
+ * pmutexbench
+ *
+ * DESCRIPTION
+ *   Play the processes in a description file with real threads that take
+ *   struct pmutex for the resources, and report how long each of them
+ *   waits for the resources. A tick is @tick_us of CPU time of a thread,
+ *   and the processes start at their ticks in the wall-clock time. All
+ *   threads run on one CPU with their priorities so that a low priority
+ *   owner can hold up a higher priority waiter as in the simulation.
+ *
+ *   The load threads run at @load_prio for @load_burst ticks every
+ *   @load_period ticks, and preempt the owners below them to make the
+ *   inversions that the protocols have to bound.
+ */
+static struct
+{
+	unsigned int tick_us;
+	unsigned int nr_runs;
+	unsigned int nr_loads;
+	unsigned int load_prio;
+	unsigned int load_burst;
+	unsigned int load_period;
+} config = {
+	.tick_us = 1000,
+	.nr_runs = 10,
+	.nr_loads = 0,
+	.load_prio = 15,
+	.load_burst = 2,
+	.load_period = 4,
+};
+
+static struct protocol
+{
+	char option;
+	const char *name;
+	enum pmutex_protocol protocol;
+} __protocols[] = {
+	{'n', "none", PMUTEX_NONE},
+	{'i', "inherit", PMUTEX_INHERIT},
+	{'c', "ceiling", PMUTEX_CEILING},
+};
+
+#define NR_PROTOCOLS (sizeof(__protocols) / sizeof(__protocols[0]))
+
+/**
+ * A thread playing a process, and what it went through over the runs
+ */
+struct player
+{
+	const struct script_process *sp;
+	pthread_t thread;
+
+	unsigned long long nr_acquires;
+	unsigned long long nr_failed;
+	unsigned long long wait_ns;
+	unsigned long long max_wait_ns;
+	unsigned long long finish_ns; /* Sum of the turnaround times */
+};
+
+static struct script script;
+static struct pmutex *mutexes;
+static unsigned int nr_mutexes;
+static unsigned long long started_at;
+static bool done;
+
+static inline unsigned long long __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void __sleep_until(unsigned long long ns)
+{
+	struct timespec ts = {
+		.tv_sec = ns / 1000000000ULL,
+		.tv_nsec = ns % 1000000000ULL,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+/**
+ * Spend @nr_ticks ticks of the CPU time of the calling thread, not counting
+ * the time that other threads take the CPU away
+ */
+static void __work(unsigned int nr_ticks)
+{
+	struct timespec ts;
+	unsigned long long until;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	until = ts.tv_sec * 1000000000ULL + ts.tv_nsec + nr_ticks * config.tick_us * 1000ULL;
+
+	do
+	{
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	} while (ts.tv_sec * 1000000000ULL + ts.tv_nsec < until);
+}
+
+/**
+ * Release the acquisitions in @held that end by @age, the latest one first.
+ * Return the number of the ones left in @held
+ */
+static unsigned int __release(const struct script_acquire **held, unsigned int nr_held, int age)
+{
+	unsigned int nr = 0;
+
+	for (int i = nr_held - 1; i >= 0; i--)
+	{
+		if (held[i]->at + held[i]->duration <= age)
+			pmutex_unlock(mutexes + held[i]->resource_id);
+	}
+
+	for (unsigned int i = 0; i < nr_held; i++)
+	{
+		if (held[i]->at + held[i]->duration > age)
+			held[nr++] = held[i];
+	}
+	return nr;
+}
+
+static void *__play(void *arg)
+{
+	struct player *p = arg;
+	const struct script_process *sp = p->sp;
+	const struct script_acquire *acquires = script.acquires + sp->acquires;
+	const struct script_acquire *held[sp->nr_acquires + 1];
+	unsigned int nr_held = 0;
+	int age;
+
+	pmutex_setprio(sp->prio);
+
+	for (age = 0; age < (int)sp->lifespan; age++)
+	{
+		nr_held = __release(held, nr_held, age);
+
+		for (unsigned int i = 0; i < sp->nr_acquires; i++)
+		{
+			const struct script_acquire *a = acquires + i;
+			unsigned long long asked_at, waited;
+
+			if (a->at != age)
+				continue;
+
+			asked_at = __now();
+			if (pmutex_lock(mutexes + a->resource_id))
+			{
+				p->nr_failed++;
+				continue;
+			}
+			waited = __now() - asked_at;
+
+			p->nr_acquires++;
+			p->wait_ns += waited;
+			if (waited > p->max_wait_ns)
+				p->max_wait_ns = waited;
+			held[nr_held++] = a;
+		}
+
+		__work(1);
+	}
+	__release(held, nr_held, INT32_MAX);
+
+	p->finish_ns += __now() - (started_at + sp->starts_at * config.tick_us * 1000ULL);
+	return NULL;
+}
+
+static void *__load(void *arg)
+{
+	unsigned long long next = started_at;
+
+	pmutex_setprio(config.load_prio);
+
+	while (!__atomic_load_n(&done, __ATOMIC_RELAXED))
+	{
+		__work(config.load_burst);
+		next += config.load_period * config.tick_us * 1000ULL;
+		__sleep_until(next);
+	}
+	return NULL;
+}
+
+static int __compare_start(const void *a, const void *b)
+{
+	const struct player *pa = a;
+	const struct player *pb = b;
+
+	return (pa->sp->starts_at > pb->sp->starts_at) - (pa->sp->starts_at < pb->sp->starts_at);
+}
+
+/**
+ * The ceiling of a resource is the highest priority of the processes that
+ * acquire it
+ */
+static unsigned int __ceiling(int resource_id)
+{
+	unsigned int ceiling = 0;
+
+	for (unsigned int i = 0; i < script.nr_processes; i++)
+	{
+		const struct script_process *sp = script.processes + i;
+
+		for (unsigned int j = 0; j < sp->nr_acquires; j++)
+		{
+			if (script.acquires[sp->acquires + j].resource_id == resource_id &&
+				sp->prio > ceiling)
+				ceiling = sp->prio;
+		}
+	}
+	return ceiling;
+}
+
+static void __run(struct protocol *protocol, struct player *players, struct pmutex_stats *stats)
+{
+	pthread_t loads[config.nr_loads];
+
+	for (unsigned int i = 0; i < nr_mutexes; i++)
+		pmutex_init(mutexes + i, protocol->protocol, __ceiling(i));
+
+	done = false;
+	started_at = __now();
+
+	for (unsigned int i = 0; i < config.nr_loads; i++)
+		pthread_create(loads + i, NULL, __load, NULL);
+
+	/* We are above all, so the players start on time */
+	for (unsigned int i = 0; i < script.nr_processes; i++)
+	{
+		struct player *p = players + i;
+
+		__sleep_until(started_at + p->sp->starts_at * config.tick_us * 1000ULL);
+		pthread_create(&p->thread, NULL, __play, p);
+	}
+
+	for (unsigned int i = 0; i < script.nr_processes; i++)
+		pthread_join(players[i].thread, NULL);
+
+	__atomic_store_n(&done, true, __ATOMIC_RELAXED);
+	for (unsigned int i = 0; i < config.nr_loads; i++)
+		pthread_join(loads[i], NULL);
+
+	/* Leave the CPU idle for as long, or the kernel throttles the real-time
+	 * threads after they hog the CPU for a while (sched_rt_runtime_us) */
+	__sleep_until(2 * __now() - started_at);
+
+	for (unsigned int i = 0; i < nr_mutexes; i++)
+	{
+		struct pmutex_stats *s = &mutexes[i].stats;
+
+		stats[i].nr_acquires += s->nr_acquires;
+		stats[i].nr_contended += s->nr_contended;
+		stats[i].nr_syscalls += s->nr_syscalls;
+		stats[i].nr_boosts += s->nr_boosts;
+		stats[i].wait_ns += s->wait_ns;
+		if (s->max_wait_ns > stats[i].max_wait_ns)
+			stats[i].max_wait_ns = s->max_wait_ns;
+	}
+}
+
+static inline double __ticks(unsigned long long ns)
+{
+	return ns / (config.tick_us * 1000.0);
+}
+
+static void __bench(struct protocol *protocol)
+{
+	struct player players[script.nr_processes];
+	struct pmutex_stats stats[nr_mutexes];
+
+	memset(players, 0, sizeof(players));
+	memset(stats, 0, sizeof(stats));
+
+	for (unsigned int i = 0; i < script.nr_processes; i++)
+		players[i].sp = script.processes + i;
+	qsort(players, script.nr_processes, sizeof(*players), __compare_start);
+
+	for (unsigned int i = 0; i < config.nr_runs; i++)
+		__run(protocol, players, stats);
+
+	for (unsigned int i = 0; i < script.nr_processes; i++)
+	{
+		struct player *p = players + i;
+
+		printf("%-8s %5u %5u %9llu %10.2f %10.2f %10.2f",
+			   protocol->name, p->sp->pid, p->sp->prio, p->nr_acquires,
+			   p->nr_acquires ? __ticks(p->wait_ns) / p->nr_acquires : 0.0,
+			   __ticks(p->max_wait_ns), __ticks(p->finish_ns) / config.nr_runs);
+		if (p->nr_failed)
+			printf("  %llu failed", p->nr_failed);
+		printf("\n");
+	}
+
+	for (unsigned int i = 0; i < nr_mutexes; i++)
+	{
+		if (!stats[i].nr_acquires)
+			continue;
+		printf("#  resource %u: %llu acquires, %llu contended, %llu futex calls, %llu boosts, %.2f ticks at most\n",
+			   i, stats[i].nr_acquires, stats[i].nr_contended, stats[i].nr_syscalls,
+			   stats[i].nr_boosts, __ticks(stats[i].max_wait_ns));
+	}
+}
+
+/**
+ * Run everything on the first CPU, and this thread above all the others.
+ * Return false if the priorities are not available
+ */
+static bool __setup_cpu(void)
+{
+	cpu_set_t set;
+	struct sched_param param = {
+		.sched_priority = sched_get_priority_max(SCHED_FIFO),
+	};
+
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-u usec} {-r runs} {-l loads} {-P prio} {-B ticks} {-I ticks} -[n|i|c]... <description file>\n", name);
+	printf("\n");
+	printf("  -u: A tick is @usec microseconds of CPU time (1000 by default)\n");
+	printf("  -r: Repeat the processes @runs times (10 by default)\n");
+	printf("  -l: Run @loads load threads along with the processes (none by default)\n");
+	printf("  -P: The load threads run at @prio (15 by default)\n");
+	printf("  -B: The load threads run for @ticks ticks at once (2 by default)\n");
+	printf("  -I: The load threads run every @ticks ticks (4 by default)\n");
+	printf("\n");
+	printf("  -n: No protocol\n");
+	printf("  -i: Priority inheritance protocol\n");
+	printf("  -c: Priority ceiling protocol\n");
+	printf("  All of them run if none is given\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	struct protocol *protocols[NR_PROTOCOLS];
+	unsigned int nr_protocols = 0;
+
+	while ((opt = getopt(argc, argv, "u:r:l:P:B:I:nich")) != -1)
+	{
+		bool ok = true;
+
+		switch (opt)
+		{
+		case 'u':
+			config.tick_us = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'r':
+			config.nr_runs = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'l':
+			config.nr_loads = atoi(optarg);
+			break;
+		case 'P':
+			config.load_prio = atoi(optarg);
+			break;
+		case 'B':
+			config.load_burst = atoi(optarg);
+			break;
+		case 'I':
+			config.load_period = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'h':
+			ok = false;
+			break;
+		default:
+			ok = false;
+			for (unsigned int i = 0; i < NR_PROTOCOLS; i++)
+			{
+				if (__protocols[i].option == opt && nr_protocols < NR_PROTOCOLS)
+				{
+					protocols[nr_protocols++] = __protocols + i;
+					ok = true;
+					break;
+				}
+			}
+			break;
+		}
+
+		if (!ok)
+		{
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (script_load(&script, argv[optind]))
+		return EXIT_FAILURE;
+
+	if (!nr_protocols)
+	{
+		for (unsigned int i = 0; i < NR_PROTOCOLS; i++)
+			protocols[nr_protocols++] = __protocols + i;
+	}
+
+	nr_mutexes = script.max_resource_id + 1;
+	mutexes = calloc(nr_mutexes ? nr_mutexes : 1, sizeof(*mutexes));
+
+	if (!__setup_cpu())
+		printf("# Cannot run with real-time priorities, so the priorities are not enforced\n");
+
+	printf("# %s: %u process%s, tick %u us, %u run%s", argv[optind], script.nr_processes,
+		   script.nr_processes == 1 ? "" : "es", config.tick_us,
+		   config.nr_runs, config.nr_runs == 1 ? "" : "s");
+	if (config.nr_loads)
+		printf(", %u load%s at prio %u for %u/%u ticks", config.nr_loads,
+			   config.nr_loads == 1 ? "" : "s", config.load_prio,
+			   config.load_burst, config.load_period);
+	printf("\n");
+	printf("%-8s %5s %5s %9s %10s %10s %10s\n", "protocol", "pid", "prio", "acquires",
+		   "avg wait", "max wait", "turnaround");
+
+	for (unsigned int i = 0; i < nr_protocols; i++)
+		__bench(protocols[i]);
+
+	free(mutexes);
+	script_unload(&script);
+
+	return EXIT_SUCCESS;
+}
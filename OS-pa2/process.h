@@ -16,7 +16,11 @@
 #ifndef __PROCESS_H__
 #define __PROCESS_H__
 
+#include "resource.h"
+
 struct list_head;
+struct rb_node;
+struct runqueue;
 
 enum process_status
 {
@@ -48,6 +52,36 @@ struct process
 	 */
 	unsigned int prio_orig; /* The original priority of the process */
 
+	unsigned long long seq; /* Order of being enqueued into the run queue.
+							   The smaller, the earlier it is enqueued */
+	struct runqueue *rq;	/* The run queue the process is enqueued in */
+	unsigned long long epoch; /* Aging epoch when the process is enqueued
+								   into the run queue of the aging scheduler,
+								   or the boost epoch of MLFQ */
+
+	unsigned long long vruntime; /* Weighted running time for CFS */
+	unsigned int weight;		 /* Load weight for CFS, derived from @prio */
+	struct rb_node run_node;	 /* Node in the CFS run queue */
+
+	unsigned int deadline; /* Absolute deadline. UINT_MAX if none */
+
+	unsigned int level; /* Queue level in MLFQ. 0 is the top */
+	unsigned int slice; /* Ticks run in the current time slice of RR and
+						   MLFQ */
+
+	unsigned int tickets;	 /* Share of the CPU for stride and lottery */
+	unsigned long long pass; /* Virtual time of stride scheduling */
+	unsigned int slot;		 /* Slot in the lottery pool */
+
+	/**
+	 * The resource that the process waits for and in which mode. The
+	 * priority inheritance also keeps track of the mutexes that the process
+	 * holds, which make up the wait-for graph along with @waiting_for
+	 */
+	struct list_head held;
+	struct resource *waiting_for; /* NULL if not waiting */
+	enum resource_mode wait_mode;
+
 	/** DO NOT ACCESS FOLLOWING VARIABLES **/
 	unsigned int __starts_at; /* When to fork the process */
 
@@ -56,6 +90,20 @@ struct process
 
 	struct list_head __resources_holding;
 	/* Resources that the process is currently holding */
+
+	struct list_head __blocked_list;
+	/* Processes blocked on the same resource. See __watch_wakeups() */
+
+	struct
+	{
+		unsigned int first_run_at; /* When it gets a CPU first */
+		unsigned int blocked_at;   /* When it is blocked last time */
+		unsigned int woken_at;	   /* When it is woken up last time */
+		unsigned int blocked;	   /* # of ticks blocked for resources */
+		unsigned int nr_switches;
+		unsigned int nr_preempted;
+	} __stats;
+	/* Accounting for the metrics. See metrics.c */
 };
 
 /**
@@ -63,6 +111,12 @@ struct process
  */
 void dump_status(void);
 
+/**
+ * Report the deadlock that @p runs into by waiting for @p->waiting_for, and
+ * stop the simulation at the end of this tick
+ */
+void report_deadlock(struct process *p);
+
 #define MAX_PRIO 64 /* Maximum value for priority */
 
 #endif
@@ -0,0 +1,434 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+#include "process.h"
+#include "proctable.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PT_X86
+#include <immintrin.h>
+#endif
+
+void pt_init(struct proctable *t)
+{
+	t->procs = NULL;
+	t->keys = NULL;
+	t->prios = NULL;
+	t->handles = t->slots = NULL;
+	t->head = t->nr = t->nr_live = 0;
+	t->capacity = 0;
+	t->nr_handles = 0;
+	t->free_handle = PT_NONE;
+}
+
+void pt_fini(struct proctable *t)
+{
+	free(t->procs);
+	free(t->keys);
+	free(t->prios);
+	free(t->handles);
+	free(t->slots);
+	pt_init(t);
+}
+
+/**
+ * Slide the processes to the front over the holes, keeping their order, and
+ * point their handles to where they land
+ */
+static void __pt_pack(struct proctable *t)
+{
+	unsigned int i, nr = 0;
+
+	for (i = t->head; i < t->nr; i++)
+	{
+		if (!t->procs[i])
+			continue;
+		t->procs[nr] = t->procs[i];
+		t->keys[nr] = t->keys[i];
+		t->prios[nr] = t->prios[i];
+		t->handles[nr] = t->handles[i];
+		t->slots[t->handles[nr]] = nr;
+		nr++;
+	}
+	t->head = 0;
+	t->nr = nr;
+}
+
+static void __pt_grow(struct proctable *t)
+{
+	t->capacity = t->capacity ? t->capacity * 2 : 64;
+
+	t->procs = realloc(t->procs, sizeof(*t->procs) * t->capacity);
+	t->keys = realloc(t->keys, sizeof(*t->keys) * t->capacity);
+	t->prios = realloc(t->prios, sizeof(*t->prios) * t->capacity);
+	t->handles = realloc(t->handles, sizeof(*t->handles) * t->capacity);
+	t->slots = realloc(t->slots, sizeof(*t->slots) * t->capacity);
+	assert(t->procs && t->keys && t->prios && t->handles && t->slots);
+}
+
+unsigned int pt_put(struct proctable *t, struct process *p, unsigned int key)
+{
+	unsigned int h, i;
+
+	if (t->nr == t->capacity)
+	{
+		/* Reclaim the holes if they are the most, or make room otherwise */
+		if (t->nr_live < t->nr / 2)
+			__pt_pack(t);
+		else
+			__pt_grow(t);
+	}
+
+	/*
+	 * Hand out a removed one first. A new handle is only needed when all
+	 * the handles are in use, so there are never more than @capacity
+	 */
+	if (t->free_handle != PT_NONE)
+	{
+		h = t->free_handle;
+		t->free_handle = t->slots[h];
+	}
+	else
+	{
+		h = t->nr_handles++;
+	}
+
+	i = t->nr++;
+	t->procs[i] = p;
+	t->keys[i] = key;
+	t->prios[i] = p->prio;
+	t->handles[i] = h;
+	t->slots[h] = i;
+	t->nr_live++;
+
+	return h;
+}
+
+void pt_remove(struct proctable *t, unsigned int h)
+{
+	unsigned int i;
+
+	assert(h < t->nr_handles);
+	i = t->slots[h];
+	assert(i >= t->head && i < t->nr && t->procs[i] && t->handles[i] == h);
+
+	t->procs[i] = NULL;
+	t->keys[i] = PT_KEY_REMOVED;
+	t->prios[i] = PT_PRIO_REMOVED;
+
+	t->slots[h] = t->free_handle;
+	t->free_handle = h;
+
+	if (--t->nr_live == 0)
+	{
+		t->head = t->nr = 0;
+		return;
+	}
+
+	/* Mostly the processes are taken from the front */
+	while (!t->procs[t->head])
+		t->head++;
+	while (!t->procs[t->nr - 1])
+		t->nr--;
+}
+
+/***********************************************************************
+ * Selection kernels
+ *
+ * Each kernel finds the best value in @v[@from..@to) and returns the index
+ * where it first shows up. The vector kernels compare a block of entries at
+ * once, and each of their lanes keeps the best value it has seen with the
+ * index it first saw it at. The lanes are then reduced to the smallest index
+ * among those with the best value, so the kernels pick the same entry as the
+ * scalar one does, which is the earliest one in the queue.
+ *
+ * The holes have the worst value, which is where the scans start from, so
+ * they are never picked and PT_NONE comes out if there is no process or all
+ * the processes have the worst value as well.
+ *
+ * The compare instructions take signed integers, so the keys, which are
+ * unsigned, are flipped at the sign bit into the same order as signed ones
+ * while they are compared.
+ ***********************************************************************/
+static inline int32_t __pt_bias(bool max)
+{
+	return max ? 0 : INT32_MIN;
+}
+
+static inline int32_t __pt_worst(bool max)
+{
+	return max ? PT_PRIO_REMOVED : (int32_t)(PT_KEY_REMOVED ^ 0x80000000u);
+}
+
+static inline bool __pt_better(int32_t a, int32_t b, bool max)
+{
+	return max ? a > b : a < b;
+}
+
+/**
+ * Reduce @nr_lanes lanes of @best and @at, which are biased already, and
+ * then scan the rest of the entries from @i, which are all behind the ones
+ * in the lanes
+ */
+static inline unsigned int __pt_reduce(const int32_t *best, const int32_t *at, unsigned int nr_lanes,
+									   const int32_t *v, unsigned int i, unsigned int to, bool max)
+{
+	int32_t value = __pt_worst(max);
+	unsigned int h = PT_NONE;
+
+	for (unsigned int l = 0; l < nr_lanes; l++)
+	{
+		if (__pt_better(best[l], value, max) ||
+			(best[l] == value && (unsigned int)at[l] < h))
+		{
+			value = best[l];
+			h = at[l];
+		}
+	}
+
+	for (; i < to; i++)
+	{
+		if (__pt_better(v[i] ^ __pt_bias(max), value, max))
+		{
+			value = v[i] ^ __pt_bias(max);
+			h = i;
+		}
+	}
+	return h;
+}
+
+static unsigned int __pt_argmin_scalar(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_reduce(NULL, NULL, 0, v, from, to, false);
+}
+
+static unsigned int __pt_argmax_scalar(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_reduce(NULL, NULL, 0, v, from, to, true);
+}
+
+#ifdef PT_X86
+/**
+ * SSE2 has no 32-bit min/max nor blend, so the lanes that see a better value
+ * are picked with the mask of the comparison. Two vectors of 4 lanes are
+ * compared in a round to overlap their dependency chains
+ */
+__attribute__((target("sse2"))) static inline __m128i __pt_select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline unsigned int __pt_scan_sse2(const int32_t *v, unsigned int from, unsigned int to, bool max)
+{
+	__m128i best[2], at[2], idx[2];
+	const __m128i step = _mm_set1_epi32(8);
+	const __m128i bias = _mm_set1_epi32(__pt_bias(max));
+	int32_t bests[8], ats[8];
+	unsigned int i = from;
+
+	for (int k = 0; k < 2; k++)
+	{
+		best[k] = _mm_set1_epi32(__pt_worst(max));
+		at[k] = _mm_set1_epi32(PT_NONE);
+		idx[k] = _mm_setr_epi32(i + 4 * k, i + 4 * k + 1, i + 4 * k + 2, i + 4 * k + 3);
+	}
+
+	for (; i + 8 <= to; i += 8)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(v + i + 4 * k)), bias);
+			__m128i mask = max ? _mm_cmpgt_epi32(x, best[k]) : _mm_cmpgt_epi32(best[k], x);
+
+			best[k] = __pt_select_sse2(mask, x, best[k]);
+			at[k] = __pt_select_sse2(mask, idx[k], at[k]);
+			idx[k] = _mm_add_epi32(idx[k], step);
+		}
+	}
+
+	for (int k = 0; k < 2; k++)
+	{
+		_mm_storeu_si128((__m128i *)(bests + 4 * k), best[k]);
+		_mm_storeu_si128((__m128i *)(ats + 4 * k), at[k]);
+	}
+	return __pt_reduce(bests, ats, 8, v, i, to, max);
+}
+
+__attribute__((target("sse2")))
+static unsigned int __pt_argmin_sse2(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_scan_sse2(v, from, to, false);
+}
+
+__attribute__((target("sse2")))
+static unsigned int __pt_argmax_sse2(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_scan_sse2(v, from, to, true);
+}
+
+/**
+ * Same as the SSE2 one with vectors of 8 lanes, so a round compares 16
+ * entries
+ */
+__attribute__((target("avx2"), always_inline))
+static inline unsigned int __pt_scan_avx2(const int32_t *v, unsigned int from, unsigned int to, bool max)
+{
+	__m256i best[2], at[2], idx[2];
+	const __m256i step = _mm256_set1_epi32(16);
+	const __m256i bias = _mm256_set1_epi32(__pt_bias(max));
+	int32_t bests[16], ats[16];
+	unsigned int i = from;
+
+	for (int k = 0; k < 2; k++)
+	{
+		best[k] = _mm256_set1_epi32(__pt_worst(max));
+		at[k] = _mm256_set1_epi32(PT_NONE);
+		idx[k] = _mm256_add_epi32(_mm256_set1_epi32(i + 8 * k),
+								  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	}
+
+	for (; i + 16 <= to; i += 16)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(v + i + 8 * k)), bias);
+			__m256i mask = max ? _mm256_cmpgt_epi32(x, best[k]) : _mm256_cmpgt_epi32(best[k], x);
+
+			best[k] = _mm256_blendv_epi8(best[k], x, mask);
+			at[k] = _mm256_blendv_epi8(at[k], idx[k], mask);
+			idx[k] = _mm256_add_epi32(idx[k], step);
+		}
+	}
+
+	for (int k = 0; k < 2; k++)
+	{
+		_mm256_storeu_si256((__m256i *)(bests + 8 * k), best[k]);
+		_mm256_storeu_si256((__m256i *)(ats + 8 * k), at[k]);
+	}
+	return __pt_reduce(bests, ats, 16, v, i, to, max);
+}
+
+__attribute__((target("avx2")))
+static unsigned int __pt_argmin_avx2(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_scan_avx2(v, from, to, false);
+}
+
+__attribute__((target("avx2")))
+static unsigned int __pt_argmax_avx2(const int32_t *v, unsigned int from, unsigned int to)
+{
+	return __pt_scan_avx2(v, from, to, true);
+}
+
+static bool __pt_has_sse2(void)
+{
+	return !!__builtin_cpu_supports("sse2");
+}
+
+static bool __pt_has_avx2(void)
+{
+	return !!__builtin_cpu_supports("avx2");
+}
+#endif
+
+static bool __pt_has_scalar(void)
+{
+	return true;
+}
+
+/**
+ * The kernels from the widest, and the first one that the CPU supports is
+ * used unless pt_set_kernel() says otherwise
+ */
+static const struct pt_kernel
+{
+	const char *name;
+	bool (*supported)(void);
+	unsigned int (*argmin)(const int32_t *v, unsigned int from, unsigned int to);
+	unsigned int (*argmax)(const int32_t *v, unsigned int from, unsigned int to);
+} __pt_kernels[] = {
+#ifdef PT_X86
+	{"avx2", __pt_has_avx2, __pt_argmin_avx2, __pt_argmax_avx2},
+	{"sse2", __pt_has_sse2, __pt_argmin_sse2, __pt_argmax_sse2},
+#endif
+	{"scalar", __pt_has_scalar, __pt_argmin_scalar, __pt_argmax_scalar},
+};
+
+#define NR_PT_KERNELS (sizeof(__pt_kernels) / sizeof(__pt_kernels[0]))
+
+static const struct pt_kernel *__pt_kernel = &__pt_kernels[NR_PT_KERNELS - 1];
+
+/**
+ * Pick the kernels before main() so that the simulations running in parallel
+ * with -B do not race for it
+ */
+__attribute__((constructor)) static void __pt_init_kernel(void)
+{
+#ifdef PT_X86
+	__builtin_cpu_init();
+#endif
+	pt_set_kernel(NULL);
+}
+
+int pt_set_kernel(const char *name)
+{
+	for (unsigned int i = 0; i < NR_PT_KERNELS; i++)
+	{
+		const struct pt_kernel *k = __pt_kernels + i;
+
+		if (name && strcmp(name, k->name))
+			continue;
+		if (!k->supported())
+		{
+			if (name)
+				return -1;
+			continue;
+		}
+		__pt_kernel = k;
+		return 0;
+	}
+	return -1;
+}
+
+const char *pt_kernel(void)
+{
+	return __pt_kernel->name;
+}
+
+unsigned int pt_argmin(struct proctable *t)
+{
+	unsigned int i = __pt_kernel->argmin((const int32_t *)t->keys, t->head, t->nr);
+
+	/* All the processes have PT_KEY_REMOVED as the holes do. The first wins */
+	if (i == PT_NONE && t->nr_live)
+		i = t->head;
+	return i == PT_NONE ? PT_NONE : t->handles[i];
+}
+
+unsigned int pt_argmax(struct proctable *t)
+{
+	unsigned int i = __pt_kernel->argmax(t->prios, t->head, t->nr);
+
+	return i == PT_NONE ? PT_NONE : t->handles[i];
+}
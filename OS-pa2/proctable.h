@@ -0,0 +1,152 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PROCTABLE_H__
+#define __PROCTABLE_H__
+
+#include <stdint.h>
+
+#include "types.h"
+
+struct process;
+
+/**
+ * No entry. Returned by the scans of an empty table
+ */
+#define PT_NONE ((unsigned int)-1)
+
+/**
+ * A removed entry has PT_KEY_REMOVED and PT_PRIO_REMOVED so that the scans
+ * pass over it. Keys take the whole 32-bit range, and a process with the key
+ * of PT_KEY_REMOVED is still found
+ */
+#define PT_KEY_REMOVED UINT32_MAX
+#define PT_PRIO_REMOVED (-1)
+
+/***********************************************************************
+ * struct proctable
+ *
+ * DESCRIPTION
+ *   Table of processes in the structure-of-arrays layout. The processes are
+ *   kept in the order they are put in, and their hot fields are packed into
+ *   their own arrays; @keys holds what the policy orders the processes by
+ *   (e.g., the remaining time), and @prios holds their priorities. Thus,
+ *   picking the process with the smallest key or the highest priority is a
+ *   linear pass over one dense array rather than chasing the pointers to
+ *   the processes, and the one put in first wins the ties.
+ *
+ *   An entry is referred to with its handle, which stays the same from
+ *   pt_put() to pt_remove() of the entry. A removed entry is left as a hole
+ *   in the arrays, and pt_put() slides the entries over the holes to make
+ *   room; @slots maps the handles to where the entries are now, and is
+ *   updated as they move. The handle of a removed entry is handed out
+ *   again by pt_put() afterward. Entries before @head are all holes.
+ */
+struct proctable
+{
+	struct process **procs; /* NULL for a hole */
+	uint32_t *keys;
+	int32_t *prios;
+	unsigned int *handles; /* Handle of the entry in each slot */
+
+	/**
+	 * The slot of the entry for each handle. For a removed handle, this
+	 * links the next removed one from @free_handle instead
+	 */
+	unsigned int *slots;
+	unsigned int nr_handles; /* # of distinct handles handed out */
+	unsigned int free_handle;
+
+	unsigned int head;
+	unsigned int nr;	  /* # of entries including the holes */
+	unsigned int nr_live; /* # of processes in the table */
+	unsigned int capacity;
+};
+
+void pt_init(struct proctable *t);
+void pt_fini(struct proctable *t);
+
+/***********************************************************************
+ * pt_put()
+ *
+ * DESCRIPTION
+ *   Put @p at the end of @t with @key and @p->prio, which are not looked up
+ *   again while @p is in the table. Amortized O(1)
+ *
+ * RETURN
+ *   The handle of @p
+ */
+unsigned int pt_put(struct proctable *t, struct process *p, unsigned int key);
+
+/***********************************************************************
+ * pt_remove()
+ *
+ * DESCRIPTION
+ *   Take the entry @h out of @t in O(1). @h is no longer valid and may be
+ *   handed out again for another process
+ */
+void pt_remove(struct proctable *t, unsigned int h);
+
+/***********************************************************************
+ * pt_argmin() and pt_argmax()
+ *
+ * DESCRIPTION
+ *   Find the entry with the smallest key and the one with the highest
+ *   priority, respectively. The earliest one is taken among the equals
+ *
+ * RETURN
+ *   The handle of the entry
+ *   PT_NONE if @t is empty
+ */
+unsigned int pt_argmin(struct proctable *t);
+unsigned int pt_argmax(struct proctable *t);
+
+/***********************************************************************
+ * pt_set_kernel()
+ *
+ * DESCRIPTION
+ *   pt_argmin() and pt_argmax() scan the table with the vector instructions
+ *   of the CPU; AVX2 compares 8 entries in an instruction, and SSE2 does 4.
+ *   The widest kernel that the CPU supports is picked at startup, and this
+ *   switches to the kernel @name ("avx2", "sse2", or "scalar"), or back to
+ *   the widest one if @name is NULL. All kernels pick the same entry.
+ *
+ * RETURN
+ *   0 on success
+ *   -1 if the kernel is unknown or the CPU does not support it
+ */
+int pt_set_kernel(const char *name);
+
+/**
+ * The name of the kernel in use
+ */
+const char *pt_kernel(void);
+
+static inline struct process *pt_process(struct proctable *t, unsigned int h)
+{
+	return t->procs[t->slots[h]];
+}
+
+static inline unsigned int pt_key(struct proctable *t, unsigned int h)
+{
+	return t->keys[t->slots[h]];
+}
+
+static inline bool pt_empty(struct proctable *t)
+{
+	return t->nr_live == 0;
+}
+
+#endif
@@ -0,0 +1,316 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/* clock_gettime() */
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+#include "process.h"
+#include "proctable.h"
+
+/***********************************************************************
+ * ptbench
+ *
+ * DESCRIPTION
+ *   Fill a process table with random keys and priorities, punch holes into
+ *   it as the schedulers do, and time pt_argmin() and pt_argmax() with each
+ *   kernel that the CPU supports. The keys and priorities come from narrow
+ *   ranges so that there are many ties, and every kernel should pick the
+ *   same entries as the scalar one.
+ */
+static const char *__kernels[] = {"scalar", "sse2", "avx2"};
+
+#define NR_KERNELS (sizeof(__kernels) / sizeof(__kernels[0]))
+
+static struct
+{
+	unsigned int nr_entries;
+	unsigned int nr_rounds;
+	unsigned int holes;	   /* % of the entries to take out */
+	unsigned int nr_keys;  /* Keys are in [0, @nr_keys) */
+	unsigned int nr_tables; /* # of random tables to check the kernels with */
+} config = {
+	.nr_entries = 4096,
+	.nr_rounds = 20000,
+	.holes = 25,
+	.nr_keys = 1000,
+	.nr_tables = 1000,
+};
+
+static unsigned long long __seed = 0x2545f4914f6cdd1dULL;
+
+static unsigned int __random(unsigned int range)
+{
+	/* xorshift64; enough for a benchmark, and the same on every run */
+	__seed ^= __seed << 13;
+	__seed ^= __seed >> 7;
+	__seed ^= __seed << 17;
+	return (__seed >> 32) % range;
+}
+
+static inline unsigned long long __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int __put(struct proctable *t, struct process *p, bool extremes)
+{
+	unsigned int key = __random(config.nr_keys);
+
+	if (extremes && __random(2))
+		key = PT_KEY_REMOVED - __random(3);
+
+	p->prio = __random(MAX_PRIO + 1);
+	return pt_put(t, p, key);
+}
+
+/**
+ * Put @nr processes from @procs into @t, and take out @holes % of them.
+ * @handles[i] is the handle of @procs[i], or PT_NONE if it is taken out. With
+ * @extremes, some keys are at the top of the range, where the holes are
+ */
+static void __fill(struct proctable *t, struct process *procs, unsigned int *handles,
+				   unsigned int nr, unsigned int holes, bool extremes)
+{
+	pt_init(t);
+
+	for (unsigned int i = 0; i < nr; i++)
+		handles[i] = __put(t, procs + i, extremes);
+
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		if (__random(100) < holes)
+		{
+			pt_remove(t, handles[i]);
+			handles[i] = PT_NONE;
+		}
+	}
+}
+
+/**
+ * Take out and put back the processes at random, which hands out the removed
+ * handles again and makes pt_put() pack the table, and check that the handles
+ * still refer to their processes
+ */
+static int __churn(struct proctable *t, struct process *procs, unsigned int *handles,
+				   unsigned int nr, bool extremes)
+{
+	for (unsigned int n = 0; n < nr * 4; n++)
+	{
+		unsigned int i = __random(nr);
+
+		if (handles[i] == PT_NONE)
+		{
+			handles[i] = __put(t, procs + i, extremes);
+			continue;
+		}
+		pt_remove(t, handles[i]);
+		handles[i] = PT_NONE;
+	}
+
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		if (handles[i] != PT_NONE && pt_process(t, handles[i]) != procs + i)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Pick the entries the plain way; the first process with the smallest key
+ * and the first one with the highest priority
+ */
+static void __reference(struct proctable *t, unsigned int *min, unsigned int *max)
+{
+	*min = *max = PT_NONE;
+
+	for (unsigned int i = t->head; i < t->nr; i++)
+	{
+		if (!t->procs[i])
+			continue;
+		if (*min == PT_NONE || t->keys[i] < t->keys[*min])
+			*min = i;
+		if (*max == PT_NONE || t->prios[i] > t->prios[*max])
+			*max = i;
+	}
+
+	if (*min != PT_NONE)
+	{
+		*min = t->handles[*min];
+		*max = t->handles[*max];
+	}
+}
+
+/**
+ * Compare the picks of the kernels against the plain loop on many small
+ * tables, where the entries that do not fill a vector matter the most
+ */
+static int __check(struct process *procs, unsigned int *handles)
+{
+	struct proctable t;
+	int ret = 0;
+
+	for (unsigned int n = 0; n < config.nr_tables && !ret; n++)
+	{
+		unsigned int nr = __random(100);
+		unsigned int min, max;
+
+		__fill(&t, procs, handles, nr, __random(100), n % 2);
+		if (__churn(&t, procs, handles, nr, n % 2))
+		{
+			fprintf(stderr, "handles move on table %u\n", n);
+			ret = -1;
+		}
+
+		__reference(&t, &min, &max);
+
+		for (unsigned int k = 0; k < NR_KERNELS; k++)
+		{
+			if (pt_set_kernel(__kernels[k]))
+				continue;
+			if (pt_argmin(&t) != min || pt_argmax(&t) != max)
+			{
+				fprintf(stderr, "%s picks differently on table %u\n", __kernels[k], n);
+				ret = -1;
+			}
+		}
+		pt_fini(&t);
+	}
+	return ret;
+}
+
+static int __bench(struct proctable *t, unsigned int min, unsigned int max)
+{
+	unsigned long long started_at, min_ns, max_ns;
+	unsigned int h = 0;
+
+	started_at = __now();
+	for (unsigned int i = 0; i < config.nr_rounds; i++)
+		h |= pt_argmin(t) ^ min;
+	min_ns = __now() - started_at;
+
+	started_at = __now();
+	for (unsigned int i = 0; i < config.nr_rounds; i++)
+		h |= pt_argmax(t) ^ max;
+	max_ns = __now() - started_at;
+
+	if (h)
+	{
+		fprintf(stderr, "%s picks differently\n", pt_kernel());
+		return -1;
+	}
+
+	printf("%-8s %12.1f %12.2f %12.1f %12.2f\n", pt_kernel(),
+		   (double)min_ns / config.nr_rounds, (double)(t->nr - t->head) * config.nr_rounds / min_ns,
+		   (double)max_ns / config.nr_rounds, (double)(t->nr - t->head) * config.nr_rounds / max_ns);
+	return 0;
+}
+
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-n entries} {-r rounds} {-H holes} {-k keys}\n", name);
+	printf("\n");
+	printf("  -n: Put @entries processes into the table (4096 by default)\n");
+	printf("  -r: Scan the table @rounds times with each kernel (20000 by default)\n");
+	printf("  -H: Take out @holes %% of the processes (25 by default)\n");
+	printf("  -k: Draw the keys from [0, @keys) (1000 by default)\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	struct proctable t;
+	struct process *procs;
+	unsigned int *handles;
+	unsigned int min, max;
+	int ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "n:r:H:k:h")) != -1)
+	{
+		bool ok = true;
+
+		switch (opt)
+		{
+		case 'n':
+			config.nr_entries = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'r':
+			config.nr_rounds = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		case 'H':
+			config.holes = atoi(optarg);
+			ok = atoi(optarg) >= 0 && atoi(optarg) < 100;
+			break;
+		case 'k':
+			config.nr_keys = atoi(optarg);
+			ok = atoi(optarg) >= 1;
+			break;
+		default:
+			ok = false;
+			break;
+		}
+
+		if (!ok)
+		{
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	procs = calloc(config.nr_entries > 100 ? config.nr_entries : 100, sizeof(*procs));
+	handles = calloc(config.nr_entries > 100 ? config.nr_entries : 100, sizeof(*handles));
+	if (!procs || !handles)
+		return EXIT_FAILURE;
+
+	if (__check(procs, handles))
+		ret = EXIT_FAILURE;
+
+	__fill(&t, procs, handles, config.nr_entries, config.holes, false);
+
+	pt_set_kernel("scalar");
+	min = pt_argmin(&t);
+	max = pt_argmax(&t);
+
+	printf("# %u entries with %u processes, %u rounds\n", t.nr - t.head, t.nr_live, config.nr_rounds);
+	printf("%-8s %12s %12s %12s %12s\n", "kernel", "argmin ns", "entries/ns", "argmax ns", "entries/ns");
+
+	for (unsigned int k = 0; k < NR_KERNELS; k++)
+	{
+		if (pt_set_kernel(__kernels[k]))
+			continue;
+		if (__bench(&t, min, max))
+			ret = EXIT_FAILURE;
+	}
+
+	pt_fini(&t);
+	free(handles);
+	free(procs);
+	return ret;
+}
@@ -0,0 +1,324 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+
+static inline bool __rb_is_red(struct rb_node *node)
+{
+	return node && node->rb_color == RB_RED;
+}
+
+static inline bool __rb_is_black(struct rb_node *node)
+{
+	return !node || node->rb_color == RB_BLACK;
+}
+
+/**
+ * Replace @old with @new in the child link of @parent (or of @root)
+ */
+static inline void __rb_change_child(struct rb_node *old, struct rb_node *new,
+									 struct rb_node *parent, struct rb_root *root)
+{
+	if (!parent)
+		root->rb_node = new;
+	else if (parent->rb_left == old)
+		parent->rb_left = new;
+	else
+		parent->rb_right = new;
+}
+
+static void __rb_rotate_left(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *right = node->rb_right;
+	struct rb_node *parent = node->rb_parent;
+
+	node->rb_right = right->rb_left;
+	if (right->rb_left)
+		right->rb_left->rb_parent = node;
+
+	right->rb_left = node;
+	right->rb_parent = parent;
+	__rb_change_child(node, right, parent, root);
+	node->rb_parent = right;
+}
+
+static void __rb_rotate_right(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *left = node->rb_left;
+	struct rb_node *parent = node->rb_parent;
+
+	node->rb_left = left->rb_right;
+	if (left->rb_right)
+		left->rb_right->rb_parent = node;
+
+	left->rb_right = node;
+	left->rb_parent = parent;
+	__rb_change_child(node, left, parent, root);
+	node->rb_parent = left;
+}
+
+void rb_insert_color(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *parent, *gparent, *uncle;
+
+	while ((parent = node->rb_parent) && __rb_is_red(parent))
+	{
+		gparent = parent->rb_parent;
+
+		if (parent == gparent->rb_left)
+		{
+			uncle = gparent->rb_right;
+			if (__rb_is_red(uncle))
+			{
+				/* Recolor and move up the tree */
+				uncle->rb_color = parent->rb_color = RB_BLACK;
+				gparent->rb_color = RB_RED;
+				node = gparent;
+				continue;
+			}
+
+			if (node == parent->rb_right)
+			{
+				__rb_rotate_left(parent, root);
+				node = parent;
+				parent = node->rb_parent;
+			}
+
+			parent->rb_color = RB_BLACK;
+			gparent->rb_color = RB_RED;
+			__rb_rotate_right(gparent, root);
+		}
+		else
+		{
+			uncle = gparent->rb_left;
+			if (__rb_is_red(uncle))
+			{
+				uncle->rb_color = parent->rb_color = RB_BLACK;
+				gparent->rb_color = RB_RED;
+				node = gparent;
+				continue;
+			}
+
+			if (node == parent->rb_left)
+			{
+				__rb_rotate_right(parent, root);
+				node = parent;
+				parent = node->rb_parent;
+			}
+
+			parent->rb_color = RB_BLACK;
+			gparent->rb_color = RB_RED;
+			__rb_rotate_left(gparent, root);
+		}
+	}
+
+	root->rb_node->rb_color = RB_BLACK;
+}
+
+/**
+ * Restore the properties after removing a black node from under @parent.
+ * @node is the child that took the place of the removed one (may be NULL).
+ */
+static void __rb_erase_color(struct rb_node *node, struct rb_node *parent,
+							 struct rb_root *root)
+{
+	struct rb_node *sibling;
+
+	while (node != root->rb_node && __rb_is_black(node))
+	{
+		if (node == parent->rb_left)
+		{
+			sibling = parent->rb_right;
+			if (__rb_is_red(sibling))
+			{
+				sibling->rb_color = RB_BLACK;
+				parent->rb_color = RB_RED;
+				__rb_rotate_left(parent, root);
+				sibling = parent->rb_right;
+			}
+
+			if (__rb_is_black(sibling->rb_left) && __rb_is_black(sibling->rb_right))
+			{
+				sibling->rb_color = RB_RED;
+				node = parent;
+				parent = node->rb_parent;
+				continue;
+			}
+
+			if (__rb_is_black(sibling->rb_right))
+			{
+				sibling->rb_left->rb_color = RB_BLACK;
+				sibling->rb_color = RB_RED;
+				__rb_rotate_right(sibling, root);
+				sibling = parent->rb_right;
+			}
+
+			sibling->rb_color = parent->rb_color;
+			parent->rb_color = RB_BLACK;
+			sibling->rb_right->rb_color = RB_BLACK;
+			__rb_rotate_left(parent, root);
+			node = root->rb_node;
+			break;
+		}
+		else
+		{
+			sibling = parent->rb_left;
+			if (__rb_is_red(sibling))
+			{
+				sibling->rb_color = RB_BLACK;
+				parent->rb_color = RB_RED;
+				__rb_rotate_right(parent, root);
+				sibling = parent->rb_left;
+			}
+
+			if (__rb_is_black(sibling->rb_left) && __rb_is_black(sibling->rb_right))
+			{
+				sibling->rb_color = RB_RED;
+				node = parent;
+				parent = node->rb_parent;
+				continue;
+			}
+
+			if (__rb_is_black(sibling->rb_left))
+			{
+				sibling->rb_right->rb_color = RB_BLACK;
+				sibling->rb_color = RB_RED;
+				__rb_rotate_left(sibling, root);
+				sibling = parent->rb_left;
+			}
+
+			sibling->rb_color = parent->rb_color;
+			parent->rb_color = RB_BLACK;
+			sibling->rb_left->rb_color = RB_BLACK;
+			__rb_rotate_right(parent, root);
+			node = root->rb_node;
+			break;
+		}
+	}
+
+	if (node)
+		node->rb_color = RB_BLACK;
+}
+
+void rb_erase(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *child, *parent;
+	int color;
+
+	if (!node->rb_left || !node->rb_right)
+	{
+		/* At most one child. Splice the child into the place of @node */
+		child = node->rb_left ? node->rb_left : node->rb_right;
+		parent = node->rb_parent;
+		color = node->rb_color;
+
+		if (child)
+			child->rb_parent = parent;
+		__rb_change_child(node, child, parent, root);
+	}
+	else
+	{
+		/* Two children. Put the successor into the place of @node */
+		struct rb_node *successor = node->rb_right;
+
+		while (successor->rb_left)
+		{
+			successor = successor->rb_left;
+		}
+
+		child = successor->rb_right;
+		parent = successor->rb_parent;
+		color = successor->rb_color;
+
+		if (parent == node)
+		{
+			parent = successor;
+		}
+		else
+		{
+			if (child)
+				child->rb_parent = parent;
+			parent->rb_left = child;
+
+			successor->rb_right = node->rb_right;
+			node->rb_right->rb_parent = successor;
+		}
+
+		successor->rb_parent = node->rb_parent;
+		successor->rb_color = node->rb_color;
+		successor->rb_left = node->rb_left;
+		node->rb_left->rb_parent = successor;
+
+		__rb_change_child(node, successor, node->rb_parent, root);
+	}
+
+	if (color == RB_BLACK)
+		__rb_erase_color(child, parent, root);
+}
+
+struct rb_node *rb_first(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+
+	if (!node)
+		return NULL;
+
+	while (node->rb_left)
+	{
+		node = node->rb_left;
+	}
+	return node;
+}
+
+struct rb_node *rb_last(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+
+	if (!node)
+		return NULL;
+
+	while (node->rb_right)
+	{
+		node = node->rb_right;
+	}
+	return node;
+}
+
+struct rb_node *rb_next(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	/* The leftmost node in the right subtree if exists */
+	if (node->rb_right)
+	{
+		node = node->rb_right;
+		while (node->rb_left)
+		{
+			node = node->rb_left;
+		}
+		return (struct rb_node *)node;
+	}
+
+	/* Otherwise, go up until we come from a left child */
+	while ((parent = node->rb_parent) && node == parent->rb_right)
+	{
+		node = parent;
+	}
+	return parent;
+}
@@ -0,0 +1,109 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __RBTREE_H__
+#define __RBTREE_H__
+
+/**
+ * Red-black tree in the way of the Linux kernel. Like list_head, rb_node is
+ * embedded in the structure to organize, and users walk down the tree by
+ * themselves to find the place to link a new node. Then, rb_insert_color()
+ * rebalances the tree.
+ *
+ *   struct rb_node **link = &root->rb_node, *parent = NULL;
+ *
+ *   while (*link) {
+ *       parent = *link;
+ *       if (key < rb_entry(parent, struct foo, node)->key)
+ *           link = &parent->rb_left;
+ *       else
+ *           link = &parent->rb_right;
+ *   }
+ *   rb_link_node(&new->node, parent, link);
+ *   rb_insert_color(&new->node, root);
+ */
+#define RB_RED 0
+#define RB_BLACK 1
+
+struct rb_node
+{
+	struct rb_node *rb_parent;
+	struct rb_node *rb_left;
+	struct rb_node *rb_right;
+	int rb_color;
+};
+
+struct rb_root
+{
+	struct rb_node *rb_node;
+};
+
+/**
+ * rb_root with the leftmost node cached, so that rb_first_cached() is O(1)
+ */
+struct rb_root_cached
+{
+	struct rb_root rb_root;
+	struct rb_node *rb_leftmost;
+};
+
+#define RB_ROOT \
+	(struct rb_root) { NULL, }
+#define RB_ROOT_CACHED \
+	(struct rb_root_cached) { {NULL, }, NULL }
+
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define RB_EMPTY_ROOT(root) ((root)->rb_node == NULL)
+
+static inline void rb_link_node(struct rb_node *node, struct rb_node *parent,
+								struct rb_node **rb_link)
+{
+	node->rb_parent = parent;
+	node->rb_color = RB_RED;
+	node->rb_left = node->rb_right = NULL;
+
+	*rb_link = node;
+}
+
+void rb_insert_color(struct rb_node *node, struct rb_root *root);
+void rb_erase(struct rb_node *node, struct rb_root *root);
+
+struct rb_node *rb_first(const struct rb_root *root);
+struct rb_node *rb_last(const struct rb_root *root);
+struct rb_node *rb_next(const struct rb_node *node);
+
+/**
+ * Same as rb_insert_color() and rb_erase() but maintain the leftmost node.
+ * Pass @leftmost true if @node is linked at the leftmost position.
+ */
+static inline void rb_insert_color_cached(struct rb_node *node,
+										  struct rb_root_cached *root, bool leftmost)
+{
+	if (leftmost)
+		root->rb_leftmost = node;
+	rb_insert_color(node, &root->rb_root);
+}
+
+static inline void rb_erase_cached(struct rb_node *node, struct rb_root_cached *root)
+{
+	if (root->rb_leftmost == node)
+		root->rb_leftmost = rb_next(node);
+	rb_erase(node, &root->rb_root);
+}
+
+#define rb_first_cached(root) (root)->rb_leftmost
+
+#endif
@@ -0,0 +1,119 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "trace.h"
+#include "chrome.h"
+
+/***********************************************************************
+ * rendertrace
+ *
+ * DESCRIPTION
+ *   Print the events in a binary trace recorded with sched -T as sched
+ *   prints them into stderr, or in the Chrome trace event format with -c.
+ *   Either way, the trace is read and written in a streaming way.
+ */
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-c} [trace file]\n", name);
+	printf("\n");
+	printf("  -c: Print the trace in the Chrome trace event format, which\n");
+	printf("      chrome://tracing and https://ui.perfetto.dev can open\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int opt;
+	bool chrome = false;
+	struct chrome exporter;
+	struct trace_header h;
+	struct trace_event *events;
+	size_t nr_events;
+	FILE *file;
+	int ret = EXIT_FAILURE;
+
+	while ((opt = getopt(argc, argv, "ch")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			chrome = true;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc)
+	{
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(argv[optind], "rb");
+	if (!file)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if (fread(&h, sizeof(h), 1, file) != 1 ||
+		memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+		h.version != TRACE_VERSION)
+	{
+		fprintf(stderr, "%s is not a valid trace\n", argv[optind]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	events = malloc(sizeof(*events) * TRACE_BUFFER_EVENTS);
+	if (!events)
+		goto out;
+
+	if (chrome)
+		chrome_begin(&exporter, stdout, h.nr_processors > 1);
+
+	while ((nr_events = fread(events, sizeof(*events), TRACE_BUFFER_EVENTS, file)) > 0)
+	{
+		for (size_t i = 0; i < nr_events; i++)
+		{
+			if (chrome)
+				chrome_event(&exporter, events + i);
+			else
+				trace_render(stdout, h.nr_processors > 1, events + i);
+		}
+	}
+
+	if (chrome && chrome_end(&exporter))
+		goto out_free;
+
+	if (!ferror(file))
+		ret = EXIT_SUCCESS;
+out_free:
+	free(events);
+out:
+	fclose(file);
+	return ret;
+}
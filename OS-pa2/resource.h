@@ -18,6 +18,18 @@
 
 struct process;
 struct list_head;
+struct runqueue;
+
+/**
+ * How a process acquires a resource. A resource can be held by many readers
+ * in RESOURCE_SHARED at the same time, or by writers in RESOURCE_EXCLUSIVE
+ * up to its @units. Shared and exclusive holders never hold it together.
+ */
+enum resource_mode
+{
+	RESOURCE_EXCLUSIVE,
+	RESOURCE_SHARED,
+};
 
 /**
  * Resources in the system.
@@ -25,20 +37,67 @@ struct list_head;
 struct resource {
 	/**
 	 * The owner process of this resource. NULL implies the resource is free
-	 * whereas non-NULL implies @owner process owns this resource
+	 * whereas non-NULL implies @owner process owns this resource. Only a
+	 * mutex (i.e., one unit) held in RESOURCE_EXCLUSIVE has the owner; the
+	 * other holders are just counted in @nr_shared and @nr_exclusive
 	 */
 	struct process *owner;
 
+	/**
+	 * # of processes that can hold this resource exclusively at the same
+	 * time. 1 makes it a mutex, and more makes it a counting semaphore
+	 */
+	unsigned int units;
+
+	/**
+	 * Once a writer waits, at most @batch more readers are let in until a
+	 * writer takes the resource. UINT_MAX lets readers in as long as no
+	 * writer holds it, which may starve the writers
+	 */
+	unsigned int batch;
+
+	unsigned int nr_shared;	   /* # of readers holding the resource */
+	unsigned int nr_exclusive; /* # of writers holding the resource */
+	unsigned int nr_writers;   /* # of writers waiting for the resource */
+	unsigned int nr_batched;   /* # of readers let in ahead of the writers */
+
 	/**
 	 * list head to list processes that are wanting for the resource
 	 */
 	struct list_head waitqueue;
+
+	/**
+	 * The priority-based schedulers keep the waiters in the order of their
+	 * priority instead of @waitqueue. Allocated when someone waits first.
+	 */
+	struct runqueue *waiters;
+
+	/**
+	 * Linked into @owner->held by the priority inheritance
+	 */
+	struct list_head held_list;
 };
 
 /**
- * This system has 16 different resources. It is defined in sched.c as an array of
- * struct resource (i.e., struct resource resources[NR_RESOURCES];)
+ * This system has 16 different resources by default, and the number can be
+ * changed with the -R option. The resources are allocated in sched.c as an
+ * array of struct resource (i.e., struct resource resources[nr_resources];)
  */
 #define NR_RESOURCES 16
 
+/**
+ * An acquisition that a process has yet to make or is holding; acquire
+ * @resource_id at age @at, and release it after @duration ticks. The
+ * framework keeps them in __resources_to_acquire and __resources_holding
+ * of struct process.
+ */
+struct resource_schedule
+{
+	int resource_id;
+	int at;
+	int duration;
+	enum resource_mode mode;
+	struct list_head list;
+};
+
 #endif
@@ -0,0 +1,147 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+
+#include "process.h"
+#include "runqueue.h"
+
+static inline unsigned int __level(unsigned int prio)
+{
+	return prio < MAX_PRIO ? prio : MAX_PRIO;
+}
+
+static inline void __mark_level(struct runqueue *rq, unsigned int level)
+{
+	unsigned long long mask = 1ULL << (level % RQ_BITS_PER_WORD);
+
+	if (list_empty(rq->queues + level))
+		rq->bitmap[level / RQ_BITS_PER_WORD] &= ~mask;
+	else
+		rq->bitmap[level / RQ_BITS_PER_WORD] |= mask;
+}
+
+/**
+ * Return true if @p should be served before @q; the higher priority first,
+ * and the earlier enqueued one first for the same priority.
+ */
+static inline bool __precedes(struct process *p, struct process *q)
+{
+	if (p->prio != q->prio)
+		return p->prio > q->prio;
+	return p->seq < q->seq;
+}
+
+static void __insert(struct runqueue *rq, struct process *p)
+{
+	unsigned int level = __level(p->prio);
+	struct list_head *head = rq->queues + level;
+	struct list_head *pos = head->prev;
+
+	/* Newly enqueued processes go to the tail without walking the queue */
+	while (pos != head && __precedes(p, list_entry(pos, struct process, list)))
+	{
+		pos = pos->prev;
+	}
+	list_add(&p->list, pos);
+
+	__mark_level(rq, level);
+}
+
+void rq_init(struct runqueue *rq)
+{
+	for (int i = 0; i < NR_RQ_WORDS; i++)
+	{
+		rq->bitmap[i] = 0;
+	}
+	for (int i = 0; i < NR_RQ_LEVELS; i++)
+	{
+		INIT_LIST_HEAD(rq->queues + i);
+	}
+	rq->nr_running = 0;
+	rq->seq = 0;
+}
+
+void rq_enqueue(struct runqueue *rq, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	p->seq = ++rq->seq;
+	p->rq = rq;
+	__insert(rq, p);
+	rq->nr_running++;
+}
+
+/**
+ * Find the highest non-empty level. Return -1 if the run queue is empty
+ */
+static inline int __top_level(struct runqueue *rq)
+{
+	for (int i = NR_RQ_WORDS - 1; i >= 0; i--)
+	{
+		if (rq->bitmap[i])
+			return i * RQ_BITS_PER_WORD + (RQ_BITS_PER_WORD - 1) - __builtin_clzll(rq->bitmap[i]);
+	}
+	return -1;
+}
+
+struct process *rq_peek(struct runqueue *rq)
+{
+	int level = __top_level(rq);
+
+	if (level < 0)
+		return NULL;
+
+	return list_first_entry(rq->queues + level, struct process, list);
+}
+
+struct process *rq_dequeue(struct runqueue *rq)
+{
+	struct process *p = rq_peek(rq);
+
+	if (!p)
+		return NULL;
+
+	list_del_init(&p->list);
+	__mark_level(rq, __level(p->prio));
+	rq->nr_running--;
+
+	return p;
+}
+
+void rq_remove(struct process *p)
+{
+	struct runqueue *rq = p->rq;
+
+	list_del_init(&p->list);
+	__mark_level(rq, __level(p->prio));
+	rq->nr_running--;
+}
+
+void rq_reprio(struct process *p, unsigned int prio)
+{
+	struct runqueue *rq = p->rq;
+
+	list_del_init(&p->list);
+	__mark_level(rq, __level(p->prio));
+
+	p->prio = prio;
+	__insert(rq, p);
+}
@@ -0,0 +1,109 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __RUNQUEUE_H__
+#define __RUNQUEUE_H__
+
+struct process;
+
+/**
+ * Number of priority levels in the run queue. Level l holds the processes
+ * with priority l, and the top level (MAX_PRIO) also collects the processes
+ * that are boosted beyond MAX_PRIO (e.g., by the priority inheritance).
+ */
+#define NR_RQ_LEVELS (MAX_PRIO + 1)
+
+#define RQ_BITS_PER_WORD (sizeof(unsigned long long) * 8)
+#define NR_RQ_WORDS ((NR_RQ_LEVELS + RQ_BITS_PER_WORD - 1) / RQ_BITS_PER_WORD)
+
+/***********************************************************************
+ * struct runqueue
+ *
+ * DESCRIPTION
+ *   Priority-indexed run queue a la the Linux O(1) scheduler. Ready
+ *   processes are linked through @process->list into the queue of their
+ *   priority level, and @bitmap tells which levels are non-empty. Thus,
+ *   picking the process with the highest priority is a find-first-set on
+ *   @bitmap followed by a list pop.
+ *
+ *   Processes are kept in their enqueueing order (@process->seq) in each
+ *   level, so the processes with the same priority are served in the
+ *   round-robin way just like walking the ready queue from its head.
+ */
+struct runqueue
+{
+	unsigned long long bitmap[NR_RQ_WORDS];
+	struct list_head queues[NR_RQ_LEVELS];
+
+	unsigned int nr_running;	  /* # of processes in the run queue */
+	unsigned long long seq; /* Enqueueing order of the last process */
+};
+
+void rq_init(struct runqueue *rq);
+
+/***********************************************************************
+ * rq_enqueue()
+ *
+ * DESCRIPTION
+ *   Put @p at the tail of the queue for @p->prio. This is what
+ *   list_add_tail(&p->list, &readyqueue) is to the plain ready queue.
+ */
+void rq_enqueue(struct runqueue *rq, struct process *p);
+
+/***********************************************************************
+ * rq_dequeue()
+ *
+ * DESCRIPTION
+ *   Take out the process with the highest priority. If two or more
+ *   processes are with the same priority, the one enqueued first is taken.
+ *
+ * RETURN
+ *   The process with the highest priority
+ *   NULL if the run queue is empty
+ */
+struct process *rq_dequeue(struct runqueue *rq);
+
+/***********************************************************************
+ * rq_peek()
+ *
+ * DESCRIPTION
+ *   Same as rq_dequeue() but leave the process in the run queue.
+ */
+struct process *rq_peek(struct runqueue *rq);
+
+/***********************************************************************
+ * rq_reprio()
+ *
+ * DESCRIPTION
+ *   Change the priority of @p which is in a run queue to @prio. @p keeps its
+ *   enqueueing order, so it is placed among the processes in the new
+ *   level as if it had the priority from the beginning.
+ */
+void rq_reprio(struct process *p, unsigned int prio);
+
+/***********************************************************************
+ * rq_remove()
+ *
+ * DESCRIPTION
+ *   Take @p out of the run queue it is in, wherever it is in the queue.
+ */
+void rq_remove(struct process *p);
+
+static inline bool rq_empty(struct runqueue *rq)
+{
+	return rq->nr_running == 0;
+}
+
+#endif
@@ -22,55 +22,57 @@
 #include <assert.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "rbtree.h"
 
-#include "parser.h"
 #include "process.h"
 #include "resource.h"
+#include "runqueue.h"
+#include "cpu.h"
+#include "pa2sim.h"
+#include "metrics.h"
+#include "script.h"
+#include "trace.h"
 
 #include "sched.h"
 
 /**
- * List head to hold the processes ready to run
- * readyqueue를 설정하는 것. 
+ * The simulation that this thread is running. @current, @readyqueue, @ticks,
+ * @resources and so on refer to those of this simulation. See pa2sim.h
  */
-LIST_HEAD(readyqueue);
+__thread struct simulation *this_sim = NULL;
 
 /**
- * The process that is currently running
- * 처음에는 running중인 process가 없으니 null값. 
+ * Following code is to maintain the simulator itself.
  */
-struct process *current = NULL;
-
 /**
- * Number of generated ticks since the simulator was started
+ * Processes waiting to be forked. This is a binary min-heap keyed on
+ * (@__starts_at, the order in the script), so each tick only touches the
+ * processes to fork at the tick and they are forked in the script order.
+ * @order is also the index of the process description in the script.
  */
-unsigned int ticks = 0;
+struct fork_entry
+{
+	unsigned int starts_at;
+	unsigned int order;
+};
 
-/** 
- * Resources in the system.
- * 리소스는 총 16개가 있다. 
- * resource 구조체에는 리소스를 갖고있는 owner와 
- * list_head 형태인 waitqueue가 있다. 이는 앞뒤에 리소스를 필요로하는 것을 나타냄.
- */
-struct resource resources[NR_RESOURCES];
+#define __forkqueue (this_sim->forkqueue)
 
 /**
- * Following code is to maintain the simulator itself.
+ * Processors in the system. @this_cpu is one of them
  */
-struct resource_schedule
-{
-	int resource_id;
-	int at;
-	int duration;
-	struct list_head list;
-};
-// forkqueue라는 List_head를 만듬. 분기되는 queue.
-static LIST_HEAD(__forkqueue);
+#define cpus (this_sim->cpus)
 
-bool quiet = false;
+/**
+ * Event-driven mode. True if the program was started with -e option
+ */
+#define event_driven (this_sim->event_driven)
 
 static const char *__process_status_sz[] = {
 	"RDY",
@@ -83,17 +85,48 @@ static const char *__process_status_sz[] = {
  * Assorted schedulers
  * 각 스케쥴링 방식을 가져옴.
  */
-extern struct scheduler fifo_scheduler;
-extern struct scheduler sjf_scheduler;
-extern struct scheduler srtf_scheduler;
-extern struct scheduler rr_scheduler;
-extern struct scheduler prio_scheduler;
-extern struct scheduler pa_scheduler;
-extern struct scheduler pcp_scheduler;
-extern struct scheduler pip_scheduler;
+extern const struct scheduler fifo_scheduler;
+extern const struct scheduler sjf_scheduler;
+extern const struct scheduler srtf_scheduler;
+extern const struct scheduler rr_scheduler;
+extern const struct scheduler prio_scheduler;
+extern const struct scheduler pa_scheduler;
+extern const struct scheduler pcp_scheduler;
+extern const struct scheduler pip_scheduler;
+extern const struct scheduler cfs_scheduler;
+extern const struct scheduler mlfq_scheduler;
+extern const struct scheduler edf_scheduler;
+extern const struct scheduler stride_scheduler;
+extern const struct scheduler lottery_scheduler;
 
 //초기의 schedule방식을 fifo형식으로 받음.
-static struct scheduler *sched = &fifo_scheduler;
+#define sched (this_sim->sched)
+
+/**
+ * Scheduling policies and their options
+ */
+static struct policy
+{
+	char option;
+	const char *name;
+	const struct scheduler *scheduler;
+} __policies[] = {
+	{'f', "fifo", &fifo_scheduler},
+	{'s', "sjf", &sjf_scheduler},
+	{'S', "srtf", &srtf_scheduler},
+	{'r', "rr", &rr_scheduler},
+	{'p', "prio", &prio_scheduler},
+	{'a', "pa", &pa_scheduler},
+	{'c', "pcp", &pcp_scheduler},
+	{'i', "pip", &pip_scheduler},
+	{'C', "cfs", &cfs_scheduler},
+	{'M', "mlfq", &mlfq_scheduler},
+	{'E', "edf", &edf_scheduler},
+	{'t', "stride", &stride_scheduler},
+	{'l', "lottery", &lottery_scheduler},
+};
+
+#define NR_POLICIES (sizeof(__policies) / sizeof(__policies[0]))
 
 void dump_status(void)
 {
@@ -117,17 +150,23 @@ void dump_status(void)
 	}
 
 	printf("***** RESOURCES *******\n");
-	for (int i = 0; i < NR_RESOURCES; i++)
+	for (int i = 0; i < nr_resources; i++)
 	{
 		struct resource *r = resources + i;
 		;
-		if (r->owner || !list_empty(&r->waitqueue))
+		if (r->owner || r->nr_shared || r->nr_exclusive || !list_empty(&r->waitqueue) ||
+			(r->waiters && !rq_empty(r->waiters)))
 		{
 			printf("%2d: owned by ", i);
 			if (r->owner)
 			{
 				printf("%d\n", r->owner->pid);
 			}
+			else if (r->nr_shared || r->nr_exclusive)
+			{
+				printf("%u reader%s and %u of %u writers\n", r->nr_shared,
+					   r->nr_shared == 1 ? "" : "s", r->nr_exclusive, r->units);
+			}
 			else
 			{
 				printf("no one\n");
@@ -137,6 +176,14 @@ void dump_status(void)
 			{
 				printf("    %d is waiting\n", p->pid);
 			}
+
+			for (int level = NR_RQ_LEVELS - 1; r->waiters && level >= 0; level--)
+			{
+				list_for_each_entry(p, r->waiters->queues + level, list)
+				{
+					printf("    %d is waiting\n", p->pid);
+				}
+			}
 		}
 	}
 	printf("\n\n");
@@ -144,154 +191,433 @@ void dump_status(void)
 	return;
 }
 
-#define __print_event(pid, string, args...)   \
-	do                                        \
-	{                                         \
-		fprintf(stderr, "%3d: ", ticks);      \
-		for (int i = 0; i < pid; i++)         \
-		{                                     \
-			fprintf(stderr, "    ");          \
-		}                                     \
-		fprintf(stderr, string "\n", ##args); \
-	} while (0);
+void report_deadlock(struct process *p)
+{
+	struct process *q = p;
+
+	fprintf(stderr, "Deadlock at tick %u: process %u", ticks, p->pid);
+	do
+	{
+		fprintf(stderr, " -> resource %d -> process %u",
+				(int)(q->waiting_for - resources), q->waiting_for->owner->pid);
+		q = q->waiting_for->owner;
+	} while (q != p);
+	fprintf(stderr, "\n");
+
+	this_sim->deadlocked = true;
+}
+
+/**
+ * Record an event of @pid on this CPU. It goes into the trace if the events
+ * are traced in the binary form, or is printed right away otherwise.
+ */
+static inline void __print_event(enum trace_type type, unsigned int pid, int arg)
+{
+	unsigned int cpu = nr_cpus > 1 ? this_cpu->id : 0;
+
+	if (this_sim->trace)
+	{
+		trace_record(this_sim->trace, type, ticks, cpu, pid, arg);
+	}
+	else
+	{
+		struct trace_event ev = {ticks, pid, cpu, type, arg};
+		trace_render(this_sim->events, nr_cpus > 1, &ev);
+	}
+}
+
+static inline bool __fork_entry_before(struct fork_entry *a, struct fork_entry *b)
+{
+	if (a->starts_at != b->starts_at)
+		return a->starts_at < b->starts_at;
+	return a->order < b->order;
+}
+
+static inline void __fork_entry_swap(struct fork_entry *a, struct fork_entry *b)
+{
+	struct fork_entry tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static inline bool __forkqueue_empty(void)
+{
+	return __forkqueue.nr_entries == 0;
+}
+
+static void __forkqueue_sift_down(unsigned int i)
+{
+	struct fork_entry *e = __forkqueue.entries;
+
+	while (true)
+	{
+		unsigned int min = i;
+		unsigned int l = 2 * i + 1, r = 2 * i + 2;
+
+		if (l < __forkqueue.nr_entries && __fork_entry_before(e + l, e + min))
+			min = l;
+		if (r < __forkqueue.nr_entries && __fork_entry_before(e + r, e + min))
+			min = r;
+		if (min == i)
+			break;
+
+		__fork_entry_swap(e + i, e + min);
+		i = min;
+	}
+}
+
+/**
+ * Build the heap over all processes in the script at once. It takes O(n)
+ * and does not move any entry if the script is sorted by the start time
+ */
+static void __forkqueue_build(void)
+{
+	const struct script_process *sp = this_sim->script.processes;
+	unsigned int nr = this_sim->script.nr_processes;
+
+	__forkqueue.entries = malloc(sizeof(*__forkqueue.entries) * (nr ? nr : 1));
+	assert(__forkqueue.entries);
+
+	for (unsigned int i = 0; i < nr; i++)
+	{
+		__forkqueue.entries[i].starts_at = sp[i].starts_at;
+		__forkqueue.entries[i].order = i;
+	}
+	__forkqueue.nr_entries = nr;
+
+	for (unsigned int i = nr / 2; i-- > 0;)
+		__forkqueue_sift_down(i);
+}
+
+static unsigned int __forkqueue_pop(void)
+{
+	struct fork_entry *e = __forkqueue.entries;
+	unsigned int order = e[0].order;
+
+	e[0] = e[--__forkqueue.nr_entries];
+	__forkqueue_sift_down(0);
+
+	return order;
+}
+
+static inline void __print_idle(struct cpu *cpu)
+{
+	if (this_sim->trace)
+	{
+		trace_record(this_sim->trace, TRACE_IDLE, ticks, cpu->id, 0, 0);
+	}
+	else
+	{
+		struct trace_event ev = {ticks, 0, cpu->id, TRACE_IDLE, 0};
+		trace_render(this_sim->events, nr_cpus > 1, &ev);
+	}
+}
+
+/**
+ * Make @current and @readyqueue refer to those of @cpu
+ */
+static void __switch_to_cpu(struct cpu *cpu)
+{
+	if (cpu == this_cpu)
+		return;
+
+	if (this_cpu)
+	{
+		this_cpu->__current = current;
+		list_splice_init(&readyqueue, &this_cpu->__readyqueue);
+	}
+
+	this_cpu = cpu;
+	current = cpu->__current;
+	list_splice_init(&cpu->__readyqueue, &readyqueue);
+}
+
+static inline bool __cpu_has_ready(struct cpu *cpu)
+{
+	if (cpu == this_cpu)
+		return !list_empty(&readyqueue);
+	return !list_empty(&cpu->__readyqueue);
+}
 
 static inline bool strmatch(char *const str, const char *expect)
 {
 	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
 }
 
-static void __briefing_process(struct process *p)
+static void __briefing_process(const struct script_process *sp)
 {
-	struct resource_schedule *rs;
+	const struct script_acquire *sa = this_sim->script.acquires + sp->acquires;
 
 	if (quiet)
 		return;
 
-	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
-		   p->pid, p->__starts_at, p->lifespan,
-		   p->lifespan >= 2 ? "s" : "", p->prio);
+	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d",
+		   sp->pid, sp->starts_at, sp->lifespan,
+		   sp->lifespan >= 2 ? "s" : "", sp->prio);
+	if (script_deadline(sp))
+		printf(", due by tick %u", sp->starts_at + script_deadline(sp));
+	printf("\n");
 
-	list_for_each_entry(rs, &p->__resources_to_acquire, list)
+	for (unsigned int i = 0; i < sp->nr_acquires; i++, sa++)
 	{
-		printf("    Acquire resource %d at %d for %d\n", rs->resource_id, rs->at, rs->duration);
+		printf("    Acquire resource %d at %d for %d%s\n", sa->resource_id, sa->at, sa->duration,
+			   sa->mode == RESOURCE_SHARED ? " shared" : "");
 	}
 }
 
-//테스트 케이스에 있는 파일을 가져오는 함수. 이를 통해서 forkqueue와
-//resource_to_acquire을 구성한다.
-static int __load_script(char *const filename)
+struct density_change
 {
-	char line[256];
-	struct process *p = NULL;
+	unsigned int at;
+	double delta;
+};
+
+static int __compare_density_change(const void *a, const void *b)
+{
+	const struct density_change *x = a, *y = b;
+
+	if (x->at != y->at)
+		return x->at < y->at ? -1 : 1;
+	/* Leave a window before entering another at the same tick */
+	return (x->delta > y->delta) - (x->delta < y->delta);
+}
+
+/***********************************************************************
+ * __check_deadlines()
+ *
+ * DESCRIPTION
+ *   Test whether the processes with a deadline in the script can meet
+ *   their deadlines under EDF. A process needs its lifespan in the window
+ *   from its fork to its deadline, and its density is the lifespan over
+ *   the window. The jobs of a periodic process have adjacent windows, so
+ *   the total density at a tick is the utilization of the periodic
+ *   processes at that moment.
+ *
+ *   EDF meets all the deadlines on a CPU if the total density never
+ *   exceeds 1, and on @nr_cpus CPUs if it never exceeds
+ *   nr_cpus - (nr_cpus - 1) * (the largest density) [Goossens et al.].
+ *   Blocking on resources is not taken into account.
+ */
+static void __check_deadlines(const struct script *script)
+{
+	struct density_change *changes;
+	unsigned int nr_changes = 0;
+	double density = 0;
+
+	memset(&this_sim->deadlines, 0x00, sizeof(this_sim->deadlines));
 
-	FILE *file = fopen(filename, "r");
-	while (fgets(line, sizeof(line), file))
+	for (unsigned int i = 0; i < script->nr_processes; i++)
 	{
-		char *tokens[32] = {NULL};
-		int nr_tokens;
+		if (script_deadline(script->processes + i))
+			this_sim->deadlines.nr_processes++;
+	}
+	if (!this_sim->deadlines.nr_processes)
+		return;
 
-		parse_command(line, &nr_tokens, tokens);
+	changes = malloc(sizeof(*changes) * this_sim->deadlines.nr_processes * 2);
+	assert(changes);
+
+	for (unsigned int i = 0; i < script->nr_processes; i++)
+	{
+		const struct script_process *sp = script->processes + i;
+		double d;
 
-		if (nr_tokens == 0)
+		if (!script_deadline(sp))
 			continue;
 
-		if (strmatch(tokens[0], "process"))
-		{
-			assert(nr_tokens == 2);
-			/* Start processor description */
-			p = malloc(sizeof(*p));
-			memset(p, 0x00, sizeof(*p));
+		d = (double)sp->lifespan / script_deadline(sp);
+		if (d > this_sim->deadlines.max_density)
+			this_sim->deadlines.max_density = d;
 
-			p->pid = atoi(tokens[1]);
+		changes[nr_changes++] = (struct density_change){sp->starts_at, d};
+		changes[nr_changes++] = (struct density_change){sp->starts_at + script_deadline(sp), -d};
+	}
+	qsort(changes, nr_changes, sizeof(*changes), __compare_density_change);
 
-			INIT_LIST_HEAD(&p->list);
-			INIT_LIST_HEAD(&p->__resources_to_acquire);
-			INIT_LIST_HEAD(&p->__resources_holding);
+	for (unsigned int i = 0; i < nr_changes; i++)
+	{
+		density += changes[i].delta;
+		if (density > this_sim->deadlines.density)
+			this_sim->deadlines.density = density;
+	}
+	free(changes);
 
-			continue;
-		}
-		else if (strmatch(tokens[0], "end"))
-		{
-			/* End of process description */
-			struct resource_schedule *rs;
-			assert(p);
+	/* Give some room for the rounding errors in the sum */
+	this_sim->deadlines.schedulable = this_sim->deadlines.density <=
+		nr_cpus - (nr_cpus - 1) * this_sim->deadlines.max_density + 1e-9;
+}
 
-			list_add_tail(&p->list, &__forkqueue);
+//테스트 케이스에 있는 파일을 가져오는 함수. 이를 통해서 forkqueue를 구성한다.
+//프로세스들은 한 번에 배열로 잡아 두고, fork될 때 스크립트의 내용으로 채운다.
+static int __load_script(char *const filename)
+{
+	struct script *script = &this_sim->script;
 
-			__briefing_process(p);
-			p = NULL;
+	if (script_load(script, filename))
+		return false;
 
-			continue;
-		}
+	if (script->max_resource_id >= (int)nr_resources)
+	{
+		fprintf(stderr, "Resource %d is out of range. Use -R to have more resources\n",
+				script->max_resource_id);
+		return false;
+	}
 
-		if (strmatch(tokens[0], "lifespan"))
-		{
-			assert(nr_tokens == 2);
-			p->lifespan = atoi(tokens[1]);
-		}
-		else if (strmatch(tokens[0], "prio"))
-		{
-			assert(nr_tokens == 2);
-			p->prio = p->prio_orig = atoi(tokens[1]);
-		}
-		else if (strmatch(tokens[0], "start"))
-		{
-			assert(nr_tokens == 2);
-			p->__starts_at = atoi(tokens[1]);
-		}
-		else if (strmatch(tokens[0], "acquire"))
-		{
-			struct resource_schedule *rs;
-			assert(nr_tokens == 4);
+	for (unsigned int i = 0; i < script->nr_resource_configs; i++)
+	{
+		const struct script_resource *sr = script->resource_configs + i;
+
+		resources[sr->resource_id].units = sr->units;
+		resources[sr->resource_id].batch = sr->batch;
+	}
+
+	/* Take the parameters in the script unless they are given with the options */
+	if (!(this_sim->config.flags & CONFIG_MLFQ_QUANTUM) &&
+		(script->config.flags & CONFIG_MLFQ_QUANTUM))
+	{
+		this_sim->config.mlfq.nr_levels = script->config.mlfq.nr_levels;
+		memcpy(this_sim->config.mlfq.quantum, script->config.mlfq.quantum,
+			   sizeof(this_sim->config.mlfq.quantum));
+	}
+	if (!(this_sim->config.flags & CONFIG_MLFQ_BOOST) &&
+		(script->config.flags & CONFIG_MLFQ_BOOST))
+	{
+		this_sim->config.mlfq.boost = script->config.mlfq.boost;
+	}
+	if (!(this_sim->config.flags & CONFIG_RR_QUANTUM) &&
+		(script->config.flags & CONFIG_RR_QUANTUM))
+	{
+		this_sim->config.rr.quantum = script->config.rr.quantum;
+	}
+	this_sim->config.flags |= script->config.flags;
 
-			rs = malloc(sizeof(*rs));
+	/**
+	 * No allocation for each process nor each acquisition. The arrays are
+	 * zero-filled pages until the processes are forked
+	 */
+	this_sim->processes = calloc(script->nr_processes ? script->nr_processes : 1,
+								 sizeof(*this_sim->processes));
+	this_sim->schedules = calloc(script->nr_acquires ? script->nr_acquires : 1,
+								 sizeof(*this_sim->schedules));
+	assert(this_sim->processes && this_sim->schedules);
 
-			rs->resource_id = atoi(tokens[1]);
-			rs->at = atoi(tokens[2]);
-			rs->duration = atoi(tokens[3]);
+	__forkqueue_build();
+	__check_deadlines(script);
 
-			list_add_tail(&rs->list, &p->__resources_to_acquire);
-		}
-		else
-		{
-			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
-		}
+	if (quiet)
+		return true;
+
+	for (unsigned int i = 0; i < script->nr_processes; i++)
+	{
+		__briefing_process(script->processes + i);
 	}
-	fclose(file);
-	if (!quiet)
-		printf("\n");
+	if (this_sim->deadlines.nr_processes)
+	{
+		printf("\n- %u process%s with deadlines: peak density %.3f, %s\n",
+			   this_sim->deadlines.nr_processes,
+			   this_sim->deadlines.nr_processes >= 2 ? "es" : "",
+			   this_sim->deadlines.density,
+			   this_sim->deadlines.schedulable ? "schedulable under EDF"
+											   : "may miss deadlines under EDF");
+	}
+	printf("\n");
 	return true;
 }
 
+/**
+ * Realize the @order-th process in the script
+ */
+static struct process *__instantiate_process(unsigned int order)
+{
+	const struct script_process *sp = this_sim->script.processes + order;
+	const struct script_acquire *sa = this_sim->script.acquires + sp->acquires;
+	struct resource_schedule *rs = this_sim->schedules + sp->acquires;
+	struct process *p = this_sim->processes + order;
+
+	assert(sp->acquires + sp->nr_acquires <= this_sim->script.nr_acquires);
+
+	p->pid = sp->pid;
+	p->lifespan = sp->lifespan;
+	p->prio = p->prio_orig = sp->prio;
+	p->__starts_at = sp->starts_at;
+	p->deadline = script_deadline(sp) ? sp->starts_at + script_deadline(sp) : UINT_MAX;
+
+	INIT_LIST_HEAD(&p->list);
+	INIT_LIST_HEAD(&p->held);
+	INIT_LIST_HEAD(&p->__resources_to_acquire);
+	INIT_LIST_HEAD(&p->__resources_holding);
+	INIT_LIST_HEAD(&p->__blocked_list);
+
+	for (unsigned int i = 0; i < sp->nr_acquires; i++, sa++, rs++)
+	{
+		assert(sa->resource_id >= 0 && sa->resource_id < nr_resources);
+
+		rs->resource_id = sa->resource_id;
+		rs->at = sa->at;
+		rs->duration = sa->duration;
+		rs->mode = sa->mode;
+		list_add_tail(&rs->list, &p->__resources_to_acquire);
+	}
+	return p;
+}
+
+/***********************************************************************
+ * The simulation loop
+ *
+ * The functions below take the policy as @ops, and @sched stands for it in
+ * them instead of @this_sim->sched. They are all inlined into one loop, so
+ * the loop made for a policy known at compile time calls its callbacks
+ * directly, which the compiler can then inline as well. See
+ * SCHED_SPECIALIZED below.
+ */
+#define __simloop static inline __attribute__((always_inline))
+
+#undef sched
+#define sched ops
+
 /**
  * Fork process on schedule
  * 여기서 조건(만약 진행시간을 나타낸 tick보다 해당 프로세스의 start가 더 높다면 readyque로 안들어감.)
  * 그 조건에 부합하면 forkqueue에 있는 것을 readyque로 넣어준다.!!모든 정보들을 담은 채로
  */
-static int __fork_on_schedule()
+__simloop int __fork_on_schedule(const struct scheduler *ops)
 {
 	int nr_forked = 0;
-	struct process *p, *tmp;
-	list_for_each_entry_safe(p, tmp, &__forkqueue, list)
+
+	while (!__forkqueue_empty() && __forkqueue.entries[0].starts_at <= ticks)
 	{
-		if (p->__starts_at <= ticks)
-		{
-			list_move_tail(&p->list, &readyqueue);
-			p->status = PROCESS_READY;
-			__print_event(p->pid, "N");
-			if (sched->forked)
-				sched->forked(p);
-			nr_forked++;
-		}
+		struct process *p = __instantiate_process(__forkqueue_pop());
+
+		/* Spread new processes over CPUs. Idle CPUs will balance the rest */
+		__switch_to_cpu(cpus + this_sim->next_cpu);
+		this_sim->next_cpu = (this_sim->next_cpu + 1) % nr_cpus;
+
+		list_add_tail(&p->list, &readyqueue);
+		p->status = PROCESS_READY;
+		__print_event(TRACE_FORK, p->pid, 0);
+		if (this_sim->metrics)
+			metrics_forked(this_sim->metrics, p);
+		if (sched->forked)
+			sched->forked(p);
+		nr_forked++;
 	}
 	return nr_forked;
 }
 
+/**
+ * Tick when the next process is forked. UINT_MAX if no process is pending
+ */
+static unsigned int __next_fork_at(void)
+{
+	if (__forkqueue_empty())
+		return UINT_MAX;
+
+	return __forkqueue.entries[0].starts_at;
+}
+
 /**
  * Exit the process
  */
-static void __exit_process(struct process *p)
+__simloop void __exit_process(const struct scheduler *ops, struct process *p)
 {
 	/* Make sure the process is not attached to some list head */
 	assert(list_empty(&p->list));
@@ -305,15 +631,48 @@ static void __exit_process(struct process *p)
 	if (sched->exiting)
 		sched->exiting(p);
 
-	__print_event(p->pid, "X");
+	__print_event(TRACE_EXIT, p->pid, 0);
+	if (this_sim->metrics)
+		metrics_exited(this_sim->metrics, p);
+}
+
+/**
+ * Processes blocked on each resource. The policies wake them up on their own,
+ * so they are watched to tell when they are woken up if the metrics or the
+ * trace need it. NULL otherwise
+ */
+#define __blocked_on (this_sim->blocked_on)
+
+static void __watch_blocked(struct process *p, int resource_id)
+{
+	list_add_tail(&p->__blocked_list, __blocked_on + resource_id);
+	if (this_sim->metrics)
+		metrics_blocked(this_sim->metrics, p);
+}
+
+/**
+ * Find the processes woken up by the release of @resource_id
+ */
+static void __watch_wakeups(int resource_id)
+{
+	struct process *p, *tmp;
 
-	free(p);
+	list_for_each_entry_safe(p, tmp, __blocked_on + resource_id, __blocked_list)
+	{
+		if (p->status == PROCESS_WAIT)
+			continue;
+
+		list_del_init(&p->__blocked_list);
+		if (this_sim->metrics)
+			metrics_woken(this_sim->metrics, p);
+		__print_event(TRACE_WAKE, p->pid, resource_id);
+	}
 }
 
 /**
  *  resource acqutision
  */
-static bool __run_current_acquire()
+__simloop bool __run_current_acquire(const struct scheduler *ops)
 {
 	struct resource_schedule *rs, *tmp;
 
@@ -324,14 +683,16 @@ static bool __run_current_acquire()
 			assert(sched->acquire && "scheduler.acquire() not implemented");
 
 			/* Callback to acquire the resource */
-			if (sched->acquire(rs->resource_id))
+			if (sched->acquire(rs->resource_id, rs->mode))
 			{
 				list_move_tail(&rs->list, &current->__resources_holding);
 
-				__print_event(current->pid, "+%d", rs->resource_id);
+				__print_event(TRACE_ACQUIRE, current->pid, rs->resource_id);
 			}
 			else
 			{
+				if (__blocked_on)
+					__watch_blocked(current, rs->resource_id);
 				return false;
 			}
 		}
@@ -343,7 +704,7 @@ static bool __run_current_acquire()
 /**
  * Process resource release
  */
-static void __run_current_release()
+__simloop void __run_current_release(const struct scheduler *ops)
 {
 	struct resource_schedule *rs, *tmp;
 
@@ -356,92 +717,272 @@ static void __run_current_release()
 			/* Callback the release() */
 			sched->release(rs->resource_id);
 
-			__print_event(current->pid, "-%d", rs->resource_id);
+			__print_event(TRACE_RELEASE, current->pid, rs->resource_id);
+			if (__blocked_on)
+				__watch_wakeups(rs->resource_id);
 
 			list_del(&rs->list);
-			free(rs);
 		}
 	}
 }
 
+/**
+ * Number of ticks from now on that @current can keep running without any
+ * event; no process is forked, and @current neither acquires nor releases
+ * a resource nor exits in the ticks.
+ */
+static unsigned int __uneventful_ticks(void)
+{
+	struct resource_schedule *rs;
+	unsigned int nr_ticks = current->lifespan - current->age;
+	unsigned int next_fork = __next_fork_at();
+
+	if (next_fork - ticks < nr_ticks)
+		nr_ticks = next_fork - ticks;
+
+	list_for_each_entry(rs, &current->__resources_to_acquire, list)
+	{
+		if (rs->at >= current->age && rs->at - current->age < nr_ticks)
+			nr_ticks = rs->at - current->age;
+	}
+
+	list_for_each_entry(rs, &current->__resources_holding, list)
+	{
+		if (rs->duration - 1 < nr_ticks)
+			nr_ticks = rs->duration - 1;
+	}
+
+	return nr_ticks;
+}
+
+/**
+ * Run @current through the following uneventful ticks at once if the
+ * scheduler agrees to keep it running. Return true if any tick is run.
+ */
+__simloop bool __run_current_ahead(const struct scheduler *ops)
+{
+	struct resource_schedule *rs;
+	unsigned int nr_ticks;
+
+	if (!current || current->status != PROCESS_RUNNING || !sched->extend)
+		return false;
+
+	nr_ticks = __uneventful_ticks();
+	if (nr_ticks == 0)
+		return false;
+
+	nr_ticks = sched->extend(nr_ticks);
+	if (this_sim->metrics)
+		metrics_ran(this_sim->metrics, nr_ticks);
+
+	__print_event(TRACE_RUN, current->pid, nr_ticks);
+	current->age += nr_ticks;
+	ticks += nr_ticks;
+
+	list_for_each_entry(rs, &current->__resources_holding, list)
+	{
+		rs->duration -= nr_ticks;
+	}
+
+	return nr_ticks > 0;
+}
+
+/**
+ * Steal a ready process from other CPUs for this idle CPU. Return true if
+ * a process is migrated into @readyqueue of this CPU
+ */
+__simloop bool __steal_process(const struct scheduler *ops)
+{
+	struct cpu *thief = this_cpu;
+	struct process *p = NULL;
+
+	for (unsigned int i = 1; i < nr_cpus && !p; i++)
+	{
+		__switch_to_cpu(cpus + (thief->id + i) % nr_cpus);
+
+		if (sched->detach)
+		{
+			p = sched->detach();
+		}
+		else if (!list_empty(&readyqueue))
+		{
+			p = list_first_entry(&readyqueue, struct process, list);
+			list_del_init(&p->list);
+		}
+	}
+	__switch_to_cpu(thief);
+
+	if (!p)
+		return false;
+
+	assert(list_empty(&p->list));
+	list_add_tail(&p->list, &readyqueue);
+	__print_event(TRACE_MIGRATE, p->pid, 0);
+	if (sched->attach)
+		sched->attach(p);
+
+	return true;
+}
+
+/**
+ * Run a tick on this CPU. Return false if the CPU has nothing to run
+ */
+__simloop bool __run_cpu(const struct scheduler *ops)
+{
+	struct process *prev;
+
+	/* Ask scheduler to pick the next process to run */
+	prev = current;
+	current = sched->schedule();
+
+	//이전 tick에서 process를 실행시다면?
+	/* If the system ran a process in the previous tick, */
+	if (prev)
+	{
+		/* It could keep running but is switched out */
+		if (this_sim->metrics && prev != current &&
+			prev->status == PROCESS_RUNNING && prev->age < prev->lifespan)
+			metrics_preempted(this_sim->metrics, prev);
+
+		/* Update the process status */
+		if (prev->status == PROCESS_RUNNING)
+		{
+			prev->status = PROCESS_READY;
+		}
+
+		/* Decommission it if completed */
+		if (prev->age == prev->lifespan)
+		{
+			prev->status = PROCESS_EXIT;
+			__exit_process(ops, prev);
+		}
+	}
+
+	/* Nothing to run on this CPU. Try to take over a process from others */
+	if (!current && __steal_process(ops))
+	{
+		current = sched->schedule();
+	}
+
+	/* No process is ready to run at this moment */
+	if (!current)
+	{
+		return false;
+	}
+
+	/* Execute the current process */
+	current->status = PROCESS_RUNNING;
+	if (this_sim->metrics)
+		metrics_dispatched(this_sim->metrics, this_cpu->id, current);
+
+	/* Ensure that @current is detached from any list */
+	assert(list_empty(&current->list));
+
+	/* Try acquiring scheduled resources */
+	if (__run_current_acquire(ops))
+	{
+		/* Succesfully acquired all the resources to make a progress! */
+		__print_event(TRACE_RUN, current->pid, 1);
+
+		/* So, it ages by one tick */
+		current->age++;
+		if (this_sim->metrics)
+			metrics_ran(this_sim->metrics, 1);
+
+		/* And performs scheduled releases */
+		__run_current_release(ops);
+	}
+	else
+	{
+		/**
+		 * The current is blocked while acquiring resource(s).
+		 * In this case, @current could not make a progress in this tick
+		 */
+		__print_event(TRACE_BLOCK, current->pid, 0);
+
+		/* Thus, it is not get aged nor unable to perform releases */
+
+		/**
+		 * Other CPUs may wake up and run the blocked process before this
+		 * CPU is scheduled again. So, let it go from this CPU right now.
+		 */
+		if (nr_cpus > 1)
+			current = NULL;
+	}
+
+	return true;
+}
+
 /***********************************************************************
  * The main loop for the scheduler simulation
  */
-static void __do_simulation(void)
+__simloop void __simulation_loop(const struct scheduler *ops)
 {
+	bool idle[nr_cpus];
+
 	assert(sched->schedule && "scheduler.schedule() not implemented");
 
 	while (true)
 	{
-		struct process *prev;
+		bool busy = false;
 
-		/* Fork processes on schedule */
-		__fork_on_schedule();
+		/* Skip the ticks where nothing happens but @current runs */
+		if (event_driven && nr_cpus == 1 && __run_current_ahead(ops))
+			continue;
 
-		/* Ask scheduler to pick the next process to run */
-		prev = current;
-		current = sched->schedule();
+		/* Fork processes on schedule */
+		__fork_on_schedule(ops);
 
-		//이전 tick에서 process를 실행시다면?
-		/* If the system ran a process in the previous tick, */
-		if (prev)
+		/* Run a tick on each CPU */
+		for (unsigned int i = 0; i < nr_cpus; i++)
 		{
-			/* Update the process status */
-			if (prev->status == PROCESS_RUNNING)
-			{
-				prev->status = PROCESS_READY;
-			}
+			__switch_to_cpu(cpus + i);
+			idle[i] = !__run_cpu(ops);
+			busy |= !idle[i];
+		}
 
-			/* Decommission it if completed */
-			if (prev->age == prev->lifespan)
-			{
-				prev->status = PROCESS_EXIT;
-				__exit_process(prev);
-			}
+		/* The processes in the deadlock would never finish */
+		if (this_sim->deadlocked)
+		{
+			break;
 		}
 
 		/* No process is ready to run at this moment */
-		if (!current)
+		if (!busy)
 		{
+			bool pending = !__forkqueue_empty();
+
+			for (unsigned int i = 0; i < nr_cpus; i++)
+			{
+				pending |= __cpu_has_ready(cpus + i);
+			}
+
 			/* Quit simulation if no pending process exists */
-			if (list_empty(&readyqueue) && list_empty(&__forkqueue))
+			if (!pending)
 			{
 				break;
 			}
-
-			/* Idle temporarily */
-			fprintf(stderr, "%3d: idle\n", ticks);
 		}
-		else
-		{
-
-			/* Execute the current process */
-			current->status = PROCESS_RUNNING;
-
-			/* Ensure that @current is detached from any list */
-			assert(list_empty(&current->list));
 
-			/* Try acquiring scheduled resources */
-			if (__run_current_acquire())
-			{
-				/* Succesfully acquired all the resources to make a progress! */
-				__print_event(current->pid, "%d", current->pid);
+		/* Idle temporarily */
+		for (unsigned int i = 0; i < nr_cpus; i++)
+		{
+			if (idle[i])
+				__print_idle(cpus + i);
+		}
 
-				/* So, it ages by one tick */
-				current->age++;
+		/* Nothing can be ready until the next process is forked */
+		if (!busy && event_driven && !__forkqueue_empty())
+		{
+			unsigned int next_fork = __next_fork_at();
 
-				/* And performs scheduled releases */
-				__run_current_release();
-			}
-			else
+			while (ticks + 1 < next_fork)
 			{
-				/**
-				 * The current is blocked while acquiring resource(s).
-				 * In this case, @current could not make a progress in this tick
-				 */
-				__print_event(current->pid, "=");
-
-				/* Thus, it is not get aged nor unable to perform releases */
+				ticks++;
+				for (unsigned int i = 0; i < nr_cpus; i++)
+				{
+					__print_idle(cpus + i);
+				}
 			}
 		}
 
@@ -450,17 +991,90 @@ static void __do_simulation(void)
 	}
 }
 
+#undef sched
+#define sched (this_sim->sched)
+
+#ifdef SCHED_SPECIALIZED
+/**
+ * Stamp out the loop for each policy. The policies are constant and defined
+ * in this translation unit (see schedspec.c), so @ops->schedule() and the
+ * others are bound at compile time in the loop of the policy
+ */
+#define FOR_EACH_POLICY(x) \
+	x(fifo) x(sjf) x(srtf) x(rr) x(prio) x(pa) x(pcp) x(pip) x(cfs) x(mlfq) x(edf) x(stride) x(lottery)
+
+#define SIMLOOP(policy)                              \
+	static void __simulate_##policy(void)            \
+	{                                                \
+		__simulation_loop(&policy##_scheduler);      \
+	}
+FOR_EACH_POLICY(SIMLOOP)
+
+#define SIMLOOP_ENTRY(policy) {&policy##_scheduler, __simulate_##policy},
+static const struct
+{
+	const struct scheduler *scheduler;
+	void (*simulate)(void);
+} __simloops[] = {FOR_EACH_POLICY(SIMLOOP_ENTRY)};
+
+#define SIMLOOP_BUILD "specialized"
+#else
+#define SIMLOOP_BUILD "indirect"
+#endif
+
+static void __do_simulation(void)
+{
+#ifdef SCHED_SPECIALIZED
+	for (unsigned int i = 0; i < sizeof(__simloops) / sizeof(__simloops[0]); i++)
+	{
+		if (__simloops[i].scheduler == sched)
+		{
+			__simloops[i].simulate();
+			return;
+		}
+	}
+#endif
+	__simulation_loop(sched);
+}
+
 static void __initialize(void)
 {
+	current = NULL;
 	INIT_LIST_HEAD(&readyqueue);
+	ticks = 0;
+
+	cpus = malloc(sizeof(*cpus) * nr_cpus);
+	assert(cpus);
+	for (unsigned int i = 0; i < nr_cpus; i++)
+	{
+		cpus[i].id = i;
+		cpus[i].__current = NULL;
+		INIT_LIST_HEAD(&cpus[i].__readyqueue);
+		cpus[i].private = NULL;
+	}
+	this_cpu = cpus;
+	this_sim->next_cpu = 0;
 
-	for (int i = 0; i < NR_RESOURCES; i++)
+	resources = malloc(sizeof(*resources) * nr_resources);
+	assert(resources);
+	for (int i = 0; i < nr_resources; i++)
 	{
 		resources[i].owner = NULL;
+		resources[i].units = 1;
+		resources[i].batch = UINT_MAX;
+		resources[i].nr_shared = resources[i].nr_exclusive = 0;
+		resources[i].nr_writers = resources[i].nr_batched = 0;
 		INIT_LIST_HEAD(&(resources[i].waitqueue));
+		INIT_LIST_HEAD(&(resources[i].held_list));
+		resources[i].waiters = NULL;
 	}
 
-	INIT_LIST_HEAD(&__forkqueue);
+	__forkqueue.entries = NULL;
+	__forkqueue.nr_entries = 0;
+	this_sim->processes = NULL;
+	this_sim->schedules = NULL;
+	this_sim->blocked_on = NULL;
+	memset(&this_sim->script, 0x00, sizeof(this_sim->script));
 
 	if (quiet)
 		return;
@@ -473,6 +1087,8 @@ static void __initialize(void)
 	printf("\n");
 	printf("                                 2021 Fall\n");
 	printf("      Simulating %s scheduler\n", sched->name);
+	if (nr_cpus > 1)
+		printf("      on %u CPUs\n", nr_cpus);
 	printf("\n");
 	printf("****************************************************\n");
 	printf("   N: Forked\n");
@@ -480,14 +1096,276 @@ static void __initialize(void)
 	printf("   =: Blocked\n");
 	printf("  +n: Acquire resource n\n");
 	printf("  -n: Release resource n\n");
+	if (nr_cpus > 1)
+		printf("   M: Migrated from another CPU\n");
 	printf("\n");
 }
 
+static void __finalize(void)
+{
+	for (int i = 0; i < nr_resources; i++)
+	{
+		free(resources[i].waiters);
+	}
+	free(resources);
+	free(cpus);
+	free(__forkqueue.entries);
+	free(this_sim->processes);
+	free(this_sim->schedules);
+	free(this_sim->blocked_on);
+	script_unload(&this_sim->script);
+}
+
+/**
+ * Run the simulation of @this_sim with @scriptfile
+ */
+static int __simulate(char *const scriptfile)
+{
+	int ret = EXIT_FAILURE;
+	struct metrics metrics;
+	struct trace trace;
+
+	__initialize();
+
+	this_sim->trace = NULL;
+	if (this_sim->traced)
+	{
+		if (trace_open(&trace, this_sim->events, nr_cpus))
+			goto out;
+		this_sim->trace = &trace;
+	}
+
+	this_sim->metrics = NULL;
+	if (this_sim->metrics_format >= 0)
+	{
+		if (metrics_init(&metrics))
+			goto out;
+		this_sim->metrics = &metrics;
+	}
+
+	if (this_sim->metrics || this_sim->trace)
+	{
+		this_sim->blocked_on = malloc(sizeof(*this_sim->blocked_on) * nr_resources);
+		assert(this_sim->blocked_on);
+		for (unsigned int i = 0; i < nr_resources; i++)
+		{
+			INIT_LIST_HEAD(this_sim->blocked_on + i);
+		}
+	}
+
+	if (!__load_script(scriptfile))
+	{
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < nr_cpus; i++)
+	{
+		__switch_to_cpu(cpus + i);
+		if (sched->initialize && sched->initialize())
+		{
+			goto out;
+		}
+	}
+
+	if (this_sim->timed)
+	{
+		clock_t started_at = clock();
+		double elapsed;
+
+		__do_simulation();
+
+		elapsed = (double)(clock() - started_at) / CLOCKS_PER_SEC;
+		printf("%-12s %-32s %10u ticks %8.3f s %12.0f ticks/s\n", SIMLOOP_BUILD, sched->name,
+			   ticks, elapsed, elapsed > 0 ? ticks / elapsed : 0.0);
+	}
+	else
+	{
+		__do_simulation();
+	}
+
+	if (this_sim->metrics)
+		metrics_report(this_sim->metrics, this_sim->report, this_sim->metrics_format, sched->name);
+
+	for (unsigned int i = 0; i < nr_cpus; i++)
+	{
+		__switch_to_cpu(cpus + i);
+		if (sched->finalize)
+		{
+			sched->finalize();
+		}
+	}
+	ret = this_sim->deadlocked ? EXIT_FAILURE : EXIT_SUCCESS;
+
+out:
+	if (this_sim->trace && trace_close(this_sim->trace))
+		ret = EXIT_FAILURE;
+	if (this_sim->metrics)
+		metrics_fini(this_sim->metrics);
+	__finalize();
+	return ret;
+}
+
+/***********************************************************************
+ * Batch mode. Every selected policy runs on every given script on a pool
+ * of threads, and the events of each run are written into
+ * @outdir/<script>.<policy> instead of stderr.
+ */
+static struct
+{
+	const char *outdir;
+	unsigned int nr_threads;
+
+	struct policy *policies[NR_POLICIES];
+	unsigned int nr_policies;
+
+	char *const *scripts;
+	unsigned int nr_scripts;
+
+	const struct simulation *config; /* Options for the simulations */
+
+	pthread_mutex_t lock;
+	unsigned int next_run; /* The run to be taken by the next idle thread */
+	int status;
+} __batch = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.status = EXIT_SUCCESS,
+};
+
+static void __batch_run(char *const scriptfile, struct policy *policy)
+{
+	const char *script = strrchr(scriptfile, '/') ? strrchr(scriptfile, '/') + 1 : scriptfile;
+	char path[PATH_MAX];
+	struct simulation sim = *__batch.config;
+	int ret = EXIT_FAILURE;
+	int len;
+
+	this_sim = &sim;
+	sched = policy->scheduler;
+
+	this_sim->events = NULL;
+
+	/* A truncated path might be the one of another run, so do not open it */
+	len = snprintf(path, sizeof(path), "%s/%s.%s%s", __batch.outdir, script, policy->name,
+				   this_sim->traced ? ".trace" : "");
+	if (len < 0 || (size_t)len >= sizeof(path))
+	{
+		fprintf(stderr, "The output path is too long for %s with %s\n", scriptfile, policy->name);
+		this_sim->report = NULL;
+		goto out;
+	}
+
+	if (this_sim->metrics_format >= 0)
+	{
+		char report[PATH_MAX];
+
+		len = snprintf(report, sizeof(report), "%s/%s.%s.%s", __batch.outdir, script, policy->name,
+					   this_sim->metrics_format == METRICS_JSON ? "json" : "csv");
+		if (len < 0 || (size_t)len >= sizeof(report))
+		{
+			fprintf(stderr, "The report path is too long for %s with %s\n", scriptfile, policy->name);
+			this_sim->report = NULL;
+			goto out;
+		}
+		this_sim->report = fopen(report, "w");
+	}
+
+	this_sim->events = fopen(path, this_sim->traced ? "wb" : "w");
+
+	if (this_sim->events && this_sim->report)
+	{
+		ret = __simulate(scriptfile);
+	}
+
+out:
+	if (this_sim->events)
+		fclose(this_sim->events);
+	if (this_sim->metrics_format >= 0 && this_sim->report)
+		fclose(this_sim->report);
+
+	if (ret != EXIT_SUCCESS)
+	{
+		fprintf(stderr, "Failed to simulate %s with %s into %s\n",
+				scriptfile, policy->name, path);
+
+		pthread_mutex_lock(&__batch.lock);
+		__batch.status = EXIT_FAILURE;
+		pthread_mutex_unlock(&__batch.lock);
+	}
+
+	this_sim = NULL;
+}
+
+static void *__batch_worker(void *arg)
+{
+	unsigned int nr_runs = __batch.nr_scripts * __batch.nr_policies;
+
+	while (true)
+	{
+		unsigned int run;
+
+		pthread_mutex_lock(&__batch.lock);
+		run = __batch.next_run++;
+		pthread_mutex_unlock(&__batch.lock);
+
+		if (run >= nr_runs)
+			break;
+
+		__batch_run(__batch.scripts[run / __batch.nr_policies],
+					__batch.policies[run % __batch.nr_policies]);
+	}
+	return NULL;
+}
+
+static int __run_batch(void)
+{
+	pthread_t threads[__batch.nr_threads];
+	unsigned int nr_threads = 0;
+
+	if (!__batch.nr_policies)
+		__batch.policies[__batch.nr_policies++] = __policies;
+
+	/* The main thread is one of the threads */
+	for (unsigned int i = 1; i < __batch.nr_threads; i++)
+	{
+		if (pthread_create(threads + nr_threads, NULL, __batch_worker, NULL))
+			break;
+		nr_threads++;
+	}
+
+	/* This also covers the failure in creating the threads above */
+	__batch_worker(NULL);
+
+	for (unsigned int i = 0; i < nr_threads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	return __batch.status;
+}
+
 static void __print_usage(char *const name)
 {
-	printf("Usage: %s {-q} -[f|s|S|r|a|p|i] [process script file]\n", name);
+	printf("Usage: %s {-q} {-e} {-P} {-n cpus} {-R resources} {-m format} {-T trace} {-Q quantum} {-L quanta} {-b period} -[f|s|S|r|a|p|i|C|M|E|t|l] [process script file]\n", name);
+	printf("       %s -B outdir {-j threads} {options} -[f|s|S|r|a|p|i|C|M|E|t|l]... [process script file]...\n", name);
 	printf("\n");
-	printf("  -q: Run quietly\n\n");
+	printf("  -q: Run quietly\n");
+	printf("  -e: Skip uneventful ticks (event-driven simulation, single CPU only)\n");
+	printf("  -P: Print how many ticks the simulation loop runs in a CPU second\n");
+	printf("  -n: Simulate @cpus processors (1 by default)\n");
+	printf("  -R: Have @resources resources (%d by default)\n", NR_RESOURCES);
+	printf("  -m: Write the scheduling metrics in @format (csv or json) to stdout\n");
+	printf("      at the end, or into @outdir/<script>.<policy>.<format> with -B\n");
+	printf("  -T: Record the events into @trace in the binary form instead of\n");
+	printf("      printing them, or into @outdir/<script>.<policy>.trace with -B.\n");
+	printf("      Run rendertrace to print them out\n");
+	printf("  -B: Run all the given policies on all the given scripts, and write\n");
+	printf("      the events of each run into @outdir/<script>.<policy>\n");
+	printf("  -j: Run the batch with @threads threads (# of online CPUs by default)\n");
+	printf("  -Q: Set the time quantum of Round-robin to @quantum ticks (1 by default)\n");
+	printf("  -L: Set the time quantum of each MLFQ level from the top with\n");
+	printf("      @quanta in comma-separated ticks (1,2,4 by default)\n");
+	printf("  -b: Boost all processes to the top MLFQ level every @period ticks\n");
+	printf("      (50 by default, 0 not to boost)\n\n");
 	printf("  -f: Use FIFO scheduler (default)\n");
 	printf("  -s: Use SJF scheduler\n");
 	printf("  -S: Use SRTF scheduler\n");
@@ -496,15 +1374,66 @@ static void __print_usage(char *const name)
 	printf("  -a: Use Priority scheduler with aging\n");
 	printf("  -c: Use Priority scheduler with PCP\n");
 	printf("  -i: Use Priority scheduler with PIP\n");
+	printf("  -C: Use Completely Fair Scheduler\n");
+	printf("  -M: Use Multi-level feedback queue scheduler\n");
+	printf("  -E: Use Earliest-deadline first scheduler\n");
+	printf("  -t: Use Stride scheduler\n");
+	printf("  -l: Use Lottery scheduler\n");
 	printf("\n");
 }
 
+/**
+ * Parse comma-separated time quanta of MLFQ levels in @str into @config
+ */
+static int __parse_quanta(char *const str, struct sched_config *config)
+{
+	char *token, *saveptr;
+	unsigned int nr_levels = 0;
+
+	for (token = strtok_r(str, ",", &saveptr); token;
+		 token = strtok_r(NULL, ",", &saveptr))
+	{
+		if (nr_levels == MLFQ_MAX_LEVELS || atoi(token) < 1)
+			return -1;
+		config->mlfq.quantum[nr_levels++] = atoi(token);
+	}
+	if (!nr_levels)
+		return -1;
+
+	config->mlfq.nr_levels = nr_levels;
+	config->flags |= CONFIG_MLFQ_QUANTUM;
+	return 0;
+}
+
+static struct policy *__find_policy(int option)
+{
+	for (unsigned int i = 0; i < NR_POLICIES; i++)
+	{
+		if (__policies[i].option == option)
+			return __policies + i;
+	}
+	return NULL;
+}
+
 int main(int argc, char *const argv[])
 {
 	int opt;
-	char *scriptfile;
-
-	while ((opt = getopt(argc, argv, "qfsSrpaich")) != -1)
+	struct simulation config = {NULL, };
+	struct policy *policy;
+	const char *trace_path = NULL;
+
+	/* Options are set into @config through @this_sim */
+	this_sim = &config;
+	sched = &fifo_scheduler;
+	nr_cpus = 1;
+	nr_resources = NR_RESOURCES;
+	this_sim->events = stderr;
+	this_sim->metrics_format = -1;
+	this_sim->report = stdout;
+
+	__batch.nr_threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+	while ((opt = getopt(argc, argv, "qePn:R:m:T:B:j:Q:L:b:fsSrpaicCMEtlh")) != -1)
 	{
 
 		//각각 스케쥴링 방식으로 sched 변수에 각 스케쥴링 방식을 넣어줌.
@@ -513,35 +1442,104 @@ int main(int argc, char *const argv[])
 		case 'q':
 			quiet = true;
 			break;
-
-		case 'f':
-			sched = &fifo_scheduler;
+		case 'e':
+			event_driven = true;
 			break;
-		case 's':
-			sched = &sjf_scheduler;
+		case 'P':
+			this_sim->timed = true;
 			break;
-		case 'S':
-			sched = &srtf_scheduler;
+		case 'n':
+			if (atoi(optarg) < 1)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			nr_cpus = atoi(optarg);
 			break;
-		case 'r':
-			sched = &rr_scheduler;
+		case 'R':
+			if (atoi(optarg) < 1)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			nr_resources = atoi(optarg);
 			break;
-		case 'p':
-			sched = &prio_scheduler;
+		case 'm':
+			if (strmatch(optarg, "csv"))
+				this_sim->metrics_format = METRICS_CSV;
+			else if (strmatch(optarg, "json"))
+				this_sim->metrics_format = METRICS_JSON;
+			else
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
 			break;
-		case 'a':
-			sched = &pa_scheduler;
+		case 'T':
+			this_sim->traced = true;
+			trace_path = optarg;
 			break;
-		case 'i':
-			sched = &pip_scheduler;
+		case 'B':
+			__batch.outdir = optarg;
 			break;
-		case 'c':
-			sched = &pcp_scheduler;
+		case 'j':
+			if (atoi(optarg) < 1)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			__batch.nr_threads = atoi(optarg);
+			break;
+		case 'Q':
+			if (atoi(optarg) < 1)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			this_sim->config.rr.quantum = atoi(optarg);
+			this_sim->config.flags |= CONFIG_RR_QUANTUM;
+			break;
+		case 'L':
+			if (__parse_quanta(optarg, &this_sim->config))
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'b':
+			if (atoi(optarg) < 0)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			this_sim->config.mlfq.boost = atoi(optarg);
+			this_sim->config.flags |= CONFIG_MLFQ_BOOST;
 			break;
 		case 'h':
-		default:
 			__print_usage(argv[0]);
 			return EXIT_FAILURE;
+
+		default:
+			policy = __find_policy(opt);
+			if (!policy)
+			{
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sched = policy->scheduler;
+
+			if (__batch.nr_policies < NR_POLICIES)
+			{
+				bool selected = false;
+
+				for (unsigned int i = 0; i < __batch.nr_policies; i++)
+				{
+					selected |= __batch.policies[i] == policy;
+				}
+				if (!selected)
+					__batch.policies[__batch.nr_policies++] = policy;
+			}
+			break;
 		}
 	}
 
@@ -551,28 +1549,36 @@ int main(int argc, char *const argv[])
 		return EXIT_FAILURE;
 	}
 
-	scriptfile = argv[optind];
-
-	__initialize();
-
-	if (!__load_script(scriptfile))
+	if (__batch.outdir)
 	{
-		return EXIT_FAILURE;
+		/* The runs in the batch print nothing but the events, and clock()
+		 * cannot tell the time of a run from the others' */
+		quiet = true;
+		this_sim->timed = false;
+		__batch.config = &config;
+		__batch.scripts = argv + optind;
+		__batch.nr_scripts = argc - optind;
+
+		return __run_batch();
 	}
 
-	if (sched->initialize && sched->initialize())
+	if (this_sim->traced)
 	{
-		return EXIT_FAILURE;
-	}
+		int ret;
 
-	__do_simulation();
-
-	if (sched->finalize)
-	{
-		sched->finalize();
+		this_sim->events = fopen(trace_path, "wb");
+		if (!this_sim->events)
+		{
+			fprintf(stderr, "Cannot open %s\n", trace_path);
+			return EXIT_FAILURE;
+		}
+		ret = __simulate(argv[optind]);
+		if (fclose(this_sim->events))
+			ret = EXIT_FAILURE;
+		return ret;
 	}
 
-	return EXIT_SUCCESS;
+	return __simulate(argv[optind]);
 }
 /*          ******        DO NOT MODIFY THIS FILE        ******       */
 /*====================================================================*/
@@ -16,6 +16,8 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+#include "resource.h"
+
 /***********************************************************************
  * struct scheduler
  *
@@ -33,7 +35,8 @@ struct scheduler
 	 *
 	 * DESCRIPTION
 	 *   Call-back function for your own initialization code. It is OK to
-	 *   leave this field NULL if you don't need any initialization.
+	 *   leave this field NULL if you don't need any initialization. This is
+	 *   called for each CPU with @this_cpu pointing to the CPU.
 	 *
 	 * RETURN VALUE
 	 *   Return 0 on successful initialization.
@@ -46,7 +49,7 @@ struct scheduler
 	 *
 	 * DESCRIPTION
 	 *   Callback function for finalizing your code. Like @initialize(),
-	 *   you may leave this function NULL.
+	 *   you may leave this function NULL. This is called for each CPU too.
 	 */
 	void (*finalize)(void);
 
@@ -88,22 +91,68 @@ struct scheduler
 	struct process *(*schedule)(void);
 
 	/***********************************************************************
-	 * bool acquire(int resource_id)
+	 * unsigned int extend(unsigned int nr_ticks)
+	 *
+	 * DESCRIPTION
+	 *   Called in the event-driven mode instead of schedule() when @current
+	 *   can keep running for the next @nr_ticks ticks without any event;
+	 *   no process is forked, and @current neither acquires nor releases a
+	 *   resource nor exits during the ticks. Return for how many ticks of
+	 *   them schedule() would keep picking @current, after doing the same
+	 *   bookkeeping as the schedule() calls would do for the ticks.
+	 *   You may leave this NULL to have schedule() called on every tick.
+	 *
+	 * RETURN
+	 *   # of ticks to keep running @current (<= @nr_ticks)
+	 *   0 if schedule() should be called on this tick
+	 */
+	unsigned int (*extend)(unsigned int);
+
+	/***********************************************************************
+	 * struct process *detach(void)
+	 *
+	 * DESCRIPTION
+	 *   Called when another CPU is idle and steals a ready process from
+	 *   this CPU. Take out a process to migrate from this CPU. You may leave
+	 *   this NULL to have the framework take the first process in
+	 *   @readyqueue.
+	 *
+	 * RETURN
+	 *   process to migrate to the idle CPU
+	 *   NULL if there is no process to give away
+	 */
+	struct process *(*detach)(void);
+
+	/***********************************************************************
+	 * void attach(struct process *process)
+	 *
+	 * DESCRIPTION
+	 *   Called when @process is migrated to this CPU. @process is put at the
+	 *   tail of @readyqueue when this is called. You may leave this NULL if
+	 *   you do not need any work for the migrated process.
+	 */
+	void (*attach)(struct process *);
+
+	/***********************************************************************
+	 * bool acquire(int resource_id, enum resource_mode mode)
 	 *
 	 * DESCRIPTION
-	 *   Callback function to acquire the resource @resource_id.
+	 *   Callback function to acquire the resource @resource_id in @mode.
+	 *   See enum resource_mode in resource.h
 	 *
 	 * RETURN
 	 *   true on successful acquision
 	 *   false if the resource is already held by others or unavailable
 	 */
-	bool (*acquire)(int);
+	bool (*acquire)(int, enum resource_mode);
 
 	/***********************************************************************
 	 * void release(int resource_id)
 	 *
 	 * DESCRIPTION
-	 *   Callbacked to release the resource @resource_id
+	 *   Callbacked to release the resource @resource_id. Whether @current
+	 *   holds it shared or exclusively is told by the resource itself, as
+	 *   the two modes never hold a resource together.
 	 */
 	void (*release)(int);
 };
@@ -0,0 +1,23 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/**
+ * The policies and the framework in one translation unit, so that the
+ * simulation loop sees the callbacks of the policies. With SCHED_SPECIALIZED,
+ * sched.c makes a loop for each policy with the callbacks bound at compile
+ * time. Without it, this is the same program as sched for comparison.
+ */
+#include "pa2.c"
+#include "sched.c"
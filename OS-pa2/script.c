@@ -0,0 +1,641 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "rbtree.h"
+#include "process.h"
+#include "resource.h"
+#include "parser.h"
+#include "script.h"
+
+static inline bool strmatch(char *const str, const char *expect)
+{
+	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
+}
+
+/**
+ * Make room for one more record in @array of @capacity records
+ */
+static void *__reserve(void *array, unsigned int nr, unsigned int *capacity, size_t size)
+{
+	if (nr < *capacity)
+		return array;
+
+	*capacity = *capacity ? *capacity * 2 : 64;
+	array = realloc(array, size * *capacity);
+	assert(array);
+	return array;
+}
+
+enum config_block
+{
+	BLOCK_NONE,
+	BLOCK_MLFQ,
+	BLOCK_RR,
+	BLOCK_RESOURCE,
+};
+
+/**
+ * Parse a property in the resource block into @r
+ */
+static int __parse_resource(struct script_resource *r, int nr_tokens, char *tokens[])
+{
+	if (strmatch(tokens[0], "units"))
+	{
+		assert(nr_tokens == 2);
+		if (atoi(tokens[1]) < 1)
+		{
+			fprintf(stderr, "# of units should be positive\n");
+			return -1;
+		}
+		r->units = atoi(tokens[1]);
+	}
+	else if (strmatch(tokens[0], "batch"))
+	{
+		assert(nr_tokens == 2);
+		if (atoi(tokens[1]) < 0)
+		{
+			fprintf(stderr, "Reader batch should not be negative\n");
+			return -1;
+		}
+		r->batch = atoi(tokens[1]);
+	}
+	else
+	{
+		fprintf(stderr, "Unknown property %s\n", tokens[0]);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Parse a property in the rr block into @config
+ */
+static int __parse_rr(struct sched_config *config, int nr_tokens, char *tokens[])
+{
+	if (strmatch(tokens[0], "quantum"))
+	{
+		assert(nr_tokens == 2);
+		if (atoi(tokens[1]) < 1)
+		{
+			fprintf(stderr, "Time quantum should be positive\n");
+			return -1;
+		}
+		config->rr.quantum = atoi(tokens[1]);
+		config->flags |= CONFIG_RR_QUANTUM;
+	}
+	else
+	{
+		fprintf(stderr, "Unknown property %s\n", tokens[0]);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Parse a property in the mlfq block into @config
+ */
+static int __parse_mlfq(struct sched_config *config, int nr_tokens, char *tokens[])
+{
+	if (strmatch(tokens[0], "quantum"))
+	{
+		if (nr_tokens < 2 || nr_tokens > MLFQ_MAX_LEVELS + 1)
+		{
+			fprintf(stderr, "MLFQ can have 1 to %d levels\n", MLFQ_MAX_LEVELS);
+			return -1;
+		}
+		for (int i = 1; i < nr_tokens; i++)
+		{
+			if (atoi(tokens[i]) < 1)
+			{
+				fprintf(stderr, "Time quantum should be positive\n");
+				return -1;
+			}
+			config->mlfq.quantum[i - 1] = atoi(tokens[i]);
+		}
+		config->mlfq.nr_levels = nr_tokens - 1;
+		config->flags |= CONFIG_MLFQ_QUANTUM;
+	}
+	else if (strmatch(tokens[0], "boost"))
+	{
+		char *end;
+		long long boost;
+
+		boost = nr_tokens == 2 ? strtoll(tokens[1], &end, 10) : 0;
+		if (nr_tokens != 2 || *end || boost < 1 || boost > UINT32_MAX)
+		{
+			fprintf(stderr, "Boost period should be a positive number of ticks\n");
+			return -1;
+		}
+		config->mlfq.boost = boost;
+		config->flags |= CONFIG_MLFQ_BOOST;
+	}
+	else
+	{
+		fprintf(stderr, "Unknown property %s\n", tokens[0]);
+		return -1;
+	}
+	return 0;
+}
+
+/***********************************************************************
+ * __load_text()
+ *
+ * DESCRIPTION
+ *   Parse the text script in @file. A process is added when its 'end' is
+ *   met, so a process without 'end' is ignored as it used to be.
+ */
+static int __load_text(struct script *s, FILE *file)
+{
+	char line[256];
+	struct script_process *processes = NULL, *p = NULL;
+	struct script_acquire *acquires = NULL;
+	struct script_resource *configs = NULL;
+	unsigned int nr_processes = 0, nr_acquires = 0, nr_configs = 0;
+	unsigned int max_processes = 0, max_acquires = 0, max_configs = 0;
+	int max_resource_id = -1;
+	unsigned int nr_jobs = 1;
+	unsigned int nr_lines = 0;
+	enum config_block block = BLOCK_NONE;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		nr_lines++;
+
+		char *tokens[32] = {NULL};
+		int nr_tokens;
+
+		if (sscanf(line, "# seed %llu", &s->seed) == 1)
+		{
+			s->seeded = true;
+			continue;
+		}
+
+		parse_command(line, &nr_tokens, tokens);
+
+		if (nr_tokens == 0)
+			continue;
+
+		if (strmatch(tokens[0], "mlfq") || strmatch(tokens[0], "rr"))
+		{
+			assert(nr_tokens == 1 && !p && block == BLOCK_NONE);
+			block = strmatch(tokens[0], "mlfq") ? BLOCK_MLFQ : BLOCK_RR;
+			continue;
+		}
+		else if (strmatch(tokens[0], "resource"))
+		{
+			struct script_resource *r;
+			assert(nr_tokens == 2 && !p && block == BLOCK_NONE);
+
+			configs = __reserve(configs, nr_configs, &max_configs, sizeof(*configs));
+			r = configs + nr_configs++;
+			r->resource_id = atoi(tokens[1]);
+			r->units = 1;
+			r->batch = UINT32_MAX;
+
+			if (r->resource_id < 0)
+			{
+				fprintf(stderr, "Resource %d is out of range\n", r->resource_id);
+				goto out_free;
+			}
+			if (r->resource_id > max_resource_id)
+				max_resource_id = r->resource_id;
+
+			block = BLOCK_RESOURCE;
+			continue;
+		}
+		else if (block != BLOCK_NONE && !strmatch(tokens[0], "end"))
+		{
+			if (block == BLOCK_MLFQ && __parse_mlfq(&s->config, nr_tokens, tokens))
+				goto out_free;
+			if (block == BLOCK_RR && __parse_rr(&s->config, nr_tokens, tokens))
+				goto out_free;
+			if (block == BLOCK_RESOURCE &&
+				__parse_resource(configs + nr_configs - 1, nr_tokens, tokens))
+				goto out_free;
+			continue;
+		}
+
+		if (strmatch(tokens[0], "process"))
+		{
+			assert(nr_tokens == 2);
+			/* Start processor description. Drop the one not ended */
+			if (p)
+				nr_acquires = p->acquires;
+			processes = __reserve(processes, nr_processes, &max_processes,
+								  sizeof(*processes));
+
+			p = processes + nr_processes;
+			memset(p, 0x00, sizeof(*p));
+			p->pid = atoi(tokens[1]);
+			p->acquires = nr_acquires;
+			nr_jobs = 1;
+			continue;
+		}
+		else if (strmatch(tokens[0], "end"))
+		{
+			if (block != BLOCK_NONE)
+			{
+				block = BLOCK_NONE;
+				continue;
+			}
+
+			/* End of process description */
+			assert(p);
+			nr_processes++;
+
+			/* Release the rest of the jobs a period apart */
+			for (unsigned int i = 1; i < nr_jobs; i++)
+			{
+				unsigned int first = nr_processes - i;
+				struct script_process *job;
+
+				processes = __reserve(processes, nr_processes, &max_processes,
+									  sizeof(*processes));
+				job = processes + nr_processes++;
+				*job = processes[first];
+				job->starts_at += i * job->period;
+				job->acquires = nr_acquires;
+
+				for (unsigned int j = 0; j < job->nr_acquires; j++)
+				{
+					acquires = __reserve(acquires, nr_acquires, &max_acquires,
+										 sizeof(*acquires));
+					acquires[nr_acquires++] = acquires[processes[first].acquires + j];
+				}
+			}
+			p = NULL;
+			continue;
+		}
+
+		assert(p);
+		if (strmatch(tokens[0], "lifespan"))
+		{
+			assert(nr_tokens == 2);
+			p->lifespan = atoi(tokens[1]);
+		}
+		else if (strmatch(tokens[0], "prio"))
+		{
+			assert(nr_tokens == 2);
+			p->prio = atoi(tokens[1]);
+
+			if (atoi(tokens[1]) < 0 || atoi(tokens[1]) > MAX_PRIO)
+			{
+				fprintf(stderr, "Priority should be in [0, %d]\n", MAX_PRIO);
+				goto out_free;
+			}
+		}
+		else if (strmatch(tokens[0], "start"))
+		{
+			assert(nr_tokens == 2);
+			p->starts_at = atoi(tokens[1]);
+		}
+		else if (strmatch(tokens[0], "period"))
+		{
+			assert(nr_tokens == 2 || nr_tokens == 3);
+			p->period = atoi(tokens[1]);
+			nr_jobs = nr_tokens == 3 ? atoi(tokens[2]) : 1;
+
+			if (atoi(tokens[1]) < 1 || (nr_tokens == 3 && atoi(tokens[2]) < 1))
+			{
+				fprintf(stderr, "Period and # of jobs should be positive\n");
+				goto out_free;
+			}
+		}
+		else if (strmatch(tokens[0], "deadline"))
+		{
+			assert(nr_tokens == 2);
+			p->deadline = atoi(tokens[1]);
+
+			if (atoi(tokens[1]) < 1)
+			{
+				fprintf(stderr, "Deadline should be positive\n");
+				goto out_free;
+			}
+		}
+		else if (strmatch(tokens[0], "acquire"))
+		{
+			struct script_acquire *a;
+			assert(nr_tokens == 4 || nr_tokens == 5);
+
+			acquires = __reserve(acquires, nr_acquires, &max_acquires,
+								 sizeof(*acquires));
+			a = acquires + nr_acquires++;
+
+			a->resource_id = atoi(tokens[1]);
+			a->at = atoi(tokens[2]);
+			a->duration = atoi(tokens[3]);
+			a->mode = RESOURCE_EXCLUSIVE;
+
+			if (nr_tokens == 5 && strmatch(tokens[4], "shared"))
+			{
+				a->mode = RESOURCE_SHARED;
+			}
+			else if (nr_tokens == 5 && !strmatch(tokens[4], "exclusive"))
+			{
+				fprintf(stderr, "Unknown acquisition mode %s\n", tokens[4]);
+				goto out_free;
+			}
+
+			if (a->resource_id < 0)
+			{
+				fprintf(stderr, "Resource %d is out of range\n", a->resource_id);
+				goto out_free;
+			}
+			if (a->resource_id > max_resource_id)
+				max_resource_id = a->resource_id;
+
+			p->nr_acquires++;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown property %s\n", tokens[0]);
+			goto out_free;
+		}
+	}
+
+	if (p)
+		nr_acquires = p->acquires;
+
+	s->processes = processes;
+	s->nr_processes = nr_processes;
+	s->acquires = acquires;
+	s->nr_acquires = nr_acquires;
+	s->resource_configs = configs;
+	s->nr_resource_configs = nr_configs;
+	s->max_resource_id = max_resource_id;
+	return 0;
+
+out_free:
+	fprintf(stderr, "  at line %u of the script\n", nr_lines);
+	free(processes);
+	free(acquires);
+	free(configs);
+	return -1;
+}
+
+/**
+ * Check the records of the binary script at @map against its header @h, so
+ * that the simulation can take them as they are. The header is checked to
+ * have the arrays in the file already
+ */
+static bool __valid_records(const struct script_header *h, const char *map)
+{
+	const struct script_process *processes = (const void *)(map + h->processes);
+	const struct script_acquire *acquires = (const void *)(map + h->acquires);
+	const struct script_resource *configs = (const void *)(map + h->resource_configs);
+
+	if (h->max_resource_id < -1)
+		return false;
+	if ((h->config.flags & CONFIG_MLFQ_QUANTUM) &&
+		(h->config.mlfq.nr_levels < 1 || h->config.mlfq.nr_levels > MLFQ_MAX_LEVELS))
+		return false;
+
+	for (unsigned int i = 0; i < h->nr_processes; i++)
+	{
+		const struct script_process *sp = processes + i;
+
+		/* Not to wrap around with sp->acquires + sp->nr_acquires */
+		if (sp->acquires > h->nr_acquires || sp->nr_acquires > h->nr_acquires - sp->acquires)
+			return false;
+		if (sp->prio > MAX_PRIO)
+			return false;
+	}
+
+	for (unsigned int i = 0; i < h->nr_acquires; i++)
+	{
+		const struct script_acquire *sa = acquires + i;
+
+		if (sa->resource_id < 0 || sa->resource_id > h->max_resource_id)
+			return false;
+		if (sa->mode != RESOURCE_EXCLUSIVE && sa->mode != RESOURCE_SHARED)
+			return false;
+	}
+
+	for (unsigned int i = 0; i < h->nr_resource_configs; i++)
+	{
+		const struct script_resource *sr = configs + i;
+
+		if (sr->resource_id < 0 || sr->resource_id > h->max_resource_id || sr->units < 1)
+			return false;
+	}
+	return true;
+}
+
+/***********************************************************************
+ * __map_binary()
+ *
+ * DESCRIPTION
+ *   Map @fd into the memory if it is a binary script. Return 1 if mapped,
+ *   0 if it is not a binary script, or -1 if it is a broken one.
+ *   The records are used in place after they are checked once here, so a
+ *   broken file is turned down before the simulation reads past the end.
+ */
+static int __map_binary(struct script *s, int fd, const char *filename)
+{
+	struct stat st;
+	struct script_header *h;
+	void *map;
+
+	if (fstat(fd, &st) || st.st_size < sizeof(*h))
+		return 0;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return 0;
+
+	h = map;
+	if (memcmp(h->magic, SCRIPT_MAGIC, sizeof(h->magic)) != 0)
+	{
+		munmap(map, st.st_size);
+		return 0;
+	}
+
+	if (h->version != SCRIPT_VERSION ||
+		h->processes % sizeof(uint64_t) || h->acquires % sizeof(uint32_t) ||
+		h->processes > st.st_size ||
+		(st.st_size - h->processes) / sizeof(struct script_process) < h->nr_processes ||
+		h->acquires > st.st_size ||
+		(st.st_size - h->acquires) / sizeof(struct script_acquire) < h->nr_acquires ||
+		h->resource_configs % sizeof(uint32_t) || h->resource_configs > st.st_size ||
+		(st.st_size - h->resource_configs) / sizeof(struct script_resource) <
+			h->nr_resource_configs ||
+		!__valid_records(h, map))
+	{
+		fprintf(stderr, "%s is not a valid binary script\n", filename);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	s->processes = (void *)((char *)map + h->processes);
+	s->nr_processes = h->nr_processes;
+	s->acquires = (void *)((char *)map + h->acquires);
+	s->nr_acquires = h->nr_acquires;
+	s->resource_configs = (void *)((char *)map + h->resource_configs);
+	s->nr_resource_configs = h->nr_resource_configs;
+	s->max_resource_id = h->max_resource_id;
+	s->seeded = !!(h->flags & SCRIPT_SEEDED);
+	s->seed = h->seed;
+	s->config = h->config;
+	s->map = map;
+	s->map_size = st.st_size;
+	return 1;
+}
+
+int script_load(struct script *s, const char *filename)
+{
+	FILE *file;
+	int fd, ret;
+
+	memset(s, 0x00, sizeof(*s));
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return -1;
+	}
+
+	ret = __map_binary(s, fd, filename);
+	if (ret)
+	{
+		close(fd);
+		return ret > 0 ? 0 : -1;
+	}
+
+	file = fdopen(fd, "r");
+	assert(file);
+	ret = __load_text(s, file);
+	fclose(file);
+
+	return ret;
+}
+
+void script_unload(struct script *s)
+{
+	if (s->map)
+	{
+		munmap(s->map, s->map_size);
+	}
+	else
+	{
+		free((void *)s->processes);
+		free((void *)s->acquires);
+		free((void *)s->resource_configs);
+	}
+	memset(s, 0x00, sizeof(*s));
+}
+
+int script_write_text(const struct script *s, FILE *stream)
+{
+	if (s->seeded)
+		fprintf(stream, "# seed %llu\n\n", s->seed);
+
+	if (s->config.flags & (CONFIG_MLFQ_QUANTUM | CONFIG_MLFQ_BOOST))
+	{
+		fprintf(stream, "mlfq\n");
+		if (s->config.flags & CONFIG_MLFQ_QUANTUM)
+		{
+			fprintf(stream, "\tquantum");
+			for (unsigned int i = 0; i < s->config.mlfq.nr_levels; i++)
+				fprintf(stream, " %u", s->config.mlfq.quantum[i]);
+			fprintf(stream, "\n");
+		}
+		if (s->config.flags & CONFIG_MLFQ_BOOST)
+			fprintf(stream, "\tboost %u\n", s->config.mlfq.boost);
+		fprintf(stream, "end\n\n");
+	}
+
+	if (s->config.flags & CONFIG_RR_QUANTUM)
+		fprintf(stream, "rr\n\tquantum %u\nend\n\n", s->config.rr.quantum);
+
+	for (unsigned int i = 0; i < s->nr_resource_configs; i++)
+	{
+		const struct script_resource *r = s->resource_configs + i;
+
+		fprintf(stream, "resource %d\n", r->resource_id);
+		if (r->units != 1)
+			fprintf(stream, "\tunits %u\n", r->units);
+		if (r->batch != UINT32_MAX)
+			fprintf(stream, "\tbatch %u\n", r->batch);
+		fprintf(stream, "end\n\n");
+	}
+
+	for (unsigned int i = 0; i < s->nr_processes; i++)
+	{
+		const struct script_process *p = s->processes + i;
+
+		fprintf(stream, "process %u\n", p->pid);
+		fprintf(stream, "\tstart %u\n", p->starts_at);
+		fprintf(stream, "\tprio %u\n", p->prio);
+		fprintf(stream, "\tlifespan %u\n", p->lifespan);
+		if (p->period)
+			fprintf(stream, "\tperiod %u\n", p->period);
+		if (p->deadline)
+			fprintf(stream, "\tdeadline %u\n", p->deadline);
+
+		for (unsigned int j = 0; j < p->nr_acquires; j++)
+		{
+			const struct script_acquire *a = s->acquires + p->acquires + j;
+
+			fprintf(stream, "\tacquire %d %d %d%s\n", a->resource_id, a->at, a->duration,
+					a->mode == RESOURCE_SHARED ? " shared" : "");
+		}
+		fprintf(stream, "end\n\n");
+	}
+
+	return ferror(stream) ? -1 : 0;
+}
+
+int script_write_binary(const struct script *s, FILE *stream)
+{
+	struct script_header h = {
+		.magic = SCRIPT_MAGIC,
+		.version = SCRIPT_VERSION,
+		.flags = s->seeded ? SCRIPT_SEEDED : 0,
+		.seed = s->seed,
+		.config = s->config,
+		.max_resource_id = s->max_resource_id,
+		.nr_processes = s->nr_processes,
+		.nr_acquires = s->nr_acquires,
+		.nr_resource_configs = s->nr_resource_configs,
+		.processes = sizeof(h),
+		.acquires = sizeof(h) + sizeof(*s->processes) * (uint64_t)s->nr_processes,
+	};
+
+	h.resource_configs = h.acquires + sizeof(*s->acquires) * (uint64_t)s->nr_acquires;
+
+	if (fwrite(&h, sizeof(h), 1, stream) != 1)
+		return -1;
+	if (fwrite(s->processes, sizeof(*s->processes), s->nr_processes, stream) != s->nr_processes)
+		return -1;
+	if (fwrite(s->acquires, sizeof(*s->acquires), s->nr_acquires, stream) != s->nr_acquires)
+		return -1;
+	if (fwrite(s->resource_configs, sizeof(*s->resource_configs), s->nr_resource_configs,
+			   stream) != s->nr_resource_configs)
+		return -1;
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/**
+ * A process description in a script. Its resource acquisitions are
+ * @nr_acquires records from the @acquires-th one in the acquisition array.
+ * A real-time process should finish in @deadline ticks after it is forked,
+ * and the process released every @period ticks has @period as its deadline
+ * unless @deadline is given. They are 0 if not given.
+ */
+struct script_process
+{
+	uint32_t pid;
+	uint32_t starts_at;
+	uint32_t lifespan;
+	uint32_t prio;
+	uint32_t acquires;
+	uint32_t nr_acquires;
+	uint32_t period;
+	uint32_t deadline;
+};
+
+/**
+ * The relative deadline of @sp. 0 if it has no deadline
+ */
+static inline uint32_t script_deadline(const struct script_process *sp)
+{
+	return sp->deadline ? sp->deadline : sp->period;
+}
+
+/**
+ * An acquire property; acquire @resource_id at @at for @duration in @mode
+ * (enum resource_mode in resource.h). The mode is given as 'shared' or 'exclusive' after
+ * the duration, and is exclusive if not given.
+ */
+struct script_acquire
+{
+	int32_t resource_id;
+	int32_t at;
+	int32_t duration;
+	uint32_t mode;
+};
+
+/**
+ * A resource block; resource @resource_id has @units units and lets in at
+ * most @batch readers ahead of a waiting writer. See struct resource
+ *
+ *   resource 3
+ *     units 2        # Two writers can hold it at once. 1 by default
+ *     batch 4        # Unlimited by default
+ *   end
+ */
+struct script_resource
+{
+	int32_t resource_id;
+	uint32_t units;
+	uint32_t batch;
+};
+
+/**
+ * Maximum # of levels in the multi-level feedback queue
+ */
+#define MLFQ_MAX_LEVELS 16
+
+/***********************************************************************
+ * struct sched_config
+ *
+ * DESCRIPTION
+ *   Parameters of the scheduling policies. They are given with the options
+ *   or with the blocks like below in the script, and @flags tells which
+ *   ones are given.
+ *
+ *   mlfq
+ *     quantum 1 2 4  # Time quantum of each level from the top
+ *     boost 50       # Boost all processes to the top every 50 ticks
+ *   end
+ *
+ *   rr
+ *     quantum 4      # Time quantum of round-robin
+ *   end
+ */
+#define CONFIG_MLFQ_QUANTUM 0x01
+#define CONFIG_MLFQ_BOOST 0x02
+#define CONFIG_RR_QUANTUM 0x04
+
+struct sched_config
+{
+	uint32_t flags;
+	struct
+	{
+		uint32_t nr_levels;
+		uint32_t quantum[MLFQ_MAX_LEVELS];
+		uint32_t boost; /* 0 not to boost */
+	} mlfq;
+	struct
+	{
+		uint32_t quantum;
+	} rr;
+};
+
+/***********************************************************************
+ * Binary script format
+ *
+ * DESCRIPTION
+ *   The header is followed by the array of struct script_process, the
+ *   array of struct script_acquire, and the array of struct script_resource
+ *   at @processes, @acquires, and @resource_configs bytes from the
+ *   beginning of the file. The numbers are in the native byte order
+ *   of the machine that made the file.
+ *
+ *   @max_resource_id is the largest resource id that the processes
+ *   acquire or describe (-1 if none), so the file can be checked against the resources
+ *   in the system without scanning the acquisitions. @seed is the seed of
+ *   the generator that made the script if SCRIPT_SEEDED is set in @flags.
+ *   @config holds the parameters given in the script.
+ */
+#define SCRIPT_MAGIC "SCHDSCPT"
+#define SCRIPT_VERSION 6
+
+#define SCRIPT_SEEDED 0x01
+
+struct script_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+	int32_t max_resource_id;
+	uint32_t nr_processes;
+	uint32_t nr_acquires;
+	uint32_t nr_resource_configs;
+	uint64_t seed;
+	uint64_t processes;
+	uint64_t acquires;
+	uint64_t resource_configs;
+	struct sched_config config;
+};
+
+/***********************************************************************
+ * struct script
+ *
+ * DESCRIPTION
+ *   Processes described in a script file. A binary script is mapped into
+ *   the memory and @processes and @acquires point into the mapping, so
+ *   loading it does not read nor allocate anything for each record. A text
+ *   script is parsed into arrays in the same layout, and its seed is given
+ *   by a "# seed <n>" comment. The jobs of a periodic process (i.e.,
+ *   "period <ticks> <jobs>") are parsed into as many processes, a period
+ *   apart from each other.
+ */
+struct script
+{
+	const struct script_process *processes;
+	unsigned int nr_processes;
+	const struct script_acquire *acquires;
+	unsigned int nr_acquires;
+	const struct script_resource *resource_configs;
+	unsigned int nr_resource_configs;
+	int max_resource_id;
+
+	bool seeded;
+	unsigned long long seed;
+
+	struct sched_config config;
+
+	void *map;		 /* The mapping of a binary script. NULL for a text one */
+	size_t map_size;
+};
+
+/**
+ * Load @filename in either format into @s. Return 0 on success or -1 on
+ * error after printing why into stderr.
+ */
+int script_load(struct script *s, const char *filename);
+void script_unload(struct script *s);
+
+/**
+ * Write @s into @stream in the text or binary format. Return 0 on success
+ */
+int script_write_text(const struct script *s, FILE *stream);
+int script_write_binary(const struct script *s, FILE *stream);
+
+#endif
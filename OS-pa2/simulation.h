@@ -0,0 +1,126 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include <stdio.h>
+
+#include "script.h"
+
+struct process;
+struct resource;
+struct scheduler;
+struct cpu;
+struct fork_entry;
+struct resource_schedule;
+struct metrics;
+struct trace;
+
+/***********************************************************************
+ * struct simulation
+ *
+ * DESCRIPTION
+ *   Whole state of a simulation. Each thread runs one simulation at a time,
+ *   and @this_sim points to the simulation that the thread is running. So,
+ *   many simulations can run in parallel on their own threads.
+ *
+ *   pa2.c and sched.c use the names in pa2sim.h (e.g., @current and
+ *   @readyqueue) for the fields of @this_sim. The other files go through
+ *   @this_sim explicitly.
+ */
+struct simulation
+{
+	const struct scheduler *sched;
+
+	struct process *current;
+	struct list_head readyqueue;
+
+	struct cpu *cpus;
+	unsigned int nr_cpus;
+	struct cpu *this_cpu;
+	unsigned int next_cpu; /* The CPU to fork the next process on */
+
+	unsigned int ticks;
+
+	struct resource *resources;
+	unsigned int nr_resources;
+
+	/**
+	 * Processes described in the script. @processes and @schedules hold
+	 * the processes and their resource schedules in the order of the
+	 * script, and they are filled when the processes are forked.
+	 */
+	struct script script;
+	struct process *processes;
+	struct resource_schedule *schedules;
+	struct list_head *blocked_on; /* Processes blocked on each resource */
+
+	/**
+	 * Parameters of the policies. Those given with the options take
+	 * precedence over those in the script
+	 */
+	struct sched_config config;
+
+	/**
+	 * Processes with a deadline in the script, their peak total density and
+	 * the largest density of them, and whether they pass the schedulability
+	 * test. See __check_deadlines() in sched.c
+	 */
+	struct
+	{
+		unsigned int nr_processes;
+		double density;
+		double max_density;
+		bool schedulable;
+	} deadlines;
+
+	/* Processes waiting to be forked. See sched.c */
+	struct
+	{
+		struct fork_entry *entries;
+		unsigned int nr_entries;
+	} forkqueue;
+
+	bool quiet;
+	bool event_driven;
+	bool deadlocked; /* A deadlock is reported. See report_deadlock() */
+	bool timed;		 /* Report how fast the loop runs. See -P of sched */
+
+	FILE *events; /* Where to print the events. stderr by default */
+
+	/**
+	 * Record the events into @trace and write them into @events in the
+	 * binary form if @traced is set. See trace.h
+	 */
+	bool traced;
+	struct trace *trace;
+
+	/**
+	 * Metrics of the simulation, which are written into @report in
+	 * @metrics_format (enum metrics_format) at the end. NULL if the metrics
+	 * are not requested. See metrics.h
+	 */
+	struct metrics *metrics;
+	int metrics_format;
+	FILE *report;
+};
+
+/**
+ * The simulation that this thread is running
+ */
+extern __thread struct simulation *this_sim;
+
+#endif
@@ -0,0 +1,104 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "trace.h"
+
+int trace_open(struct trace *t, FILE *stream, unsigned int nr_processors)
+{
+	struct trace_header h = {
+		.magic = TRACE_MAGIC,
+		.version = TRACE_VERSION,
+		.nr_processors = nr_processors,
+	};
+
+	t->events = malloc(sizeof(*t->events) * TRACE_BUFFER_EVENTS);
+	assert(t->events);
+	t->nr_events = 0;
+	t->stream = stream;
+
+	if (fwrite(&h, sizeof(h), 1, stream) != 1)
+		return -1;
+	return 0;
+}
+
+int trace_flush(struct trace *t)
+{
+	size_t nr = t->nr_events;
+
+	t->nr_events = 0;
+	if (fwrite(t->events, sizeof(*t->events), nr, t->stream) != nr)
+		return -1;
+	return 0;
+}
+
+int trace_close(struct trace *t)
+{
+	int ret = trace_flush(t);
+
+	free(t->events);
+	t->events = NULL;
+	return ret;
+}
+
+void trace_render(FILE *stream, bool multi_cpu, const struct trace_event *ev)
+{
+	char cpu[8] = "";
+	int indent = ev->pid * 4;
+
+	if (multi_cpu)
+		snprintf(cpu, sizeof(cpu), "%2d| ", ev->cpu);
+
+	switch (ev->type)
+	{
+	case TRACE_FORK:
+		fprintf(stream, "%3d: %s%*sN\n", ev->tick, cpu, indent, "");
+		break;
+	case TRACE_EXIT:
+		fprintf(stream, "%3d: %s%*sX\n", ev->tick, cpu, indent, "");
+		break;
+	case TRACE_ACQUIRE:
+		fprintf(stream, "%3d: %s%*s+%d\n", ev->tick, cpu, indent, "", ev->arg);
+		break;
+	case TRACE_RELEASE:
+		fprintf(stream, "%3d: %s%*s-%d\n", ev->tick, cpu, indent, "", ev->arg);
+		break;
+	case TRACE_RUN:
+		for (int i = 0; i < ev->arg; i++)
+		{
+			fprintf(stream, "%3d: %s%*s%d\n", ev->tick + i, cpu, indent, "", ev->pid);
+		}
+		break;
+	case TRACE_BLOCK:
+		fprintf(stream, "%3d: %s%*s=\n", ev->tick, cpu, indent, "");
+		break;
+	case TRACE_MIGRATE:
+		fprintf(stream, "%3d: %s%*sM\n", ev->tick, cpu, indent, "");
+		break;
+	case TRACE_IDLE:
+		fprintf(stream, "%3d: %sidle\n", ev->tick, cpu);
+		break;
+	case TRACE_WAKE:
+		break;
+	default:
+		assert(0 && "Unknown trace event");
+	}
+}
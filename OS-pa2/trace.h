@@ -0,0 +1,117 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "types.h"
+
+enum trace_type
+{
+	TRACE_FORK,	   /* N */
+	TRACE_EXIT,	   /* X */
+	TRACE_ACQUIRE, /* +@arg */
+	TRACE_RELEASE, /* -@arg */
+	TRACE_RUN,	   /* @pid for @arg ticks in a row */
+	TRACE_BLOCK,   /* = */
+	TRACE_MIGRATE, /* M */
+	TRACE_IDLE,	   /* idle */
+	TRACE_WAKE,	   /* Woken up by the release of resource @arg. Not printed */
+};
+
+/**
+ * An event on @cpu at @tick. Events are this small and fixed-size so that
+ * recording one costs a few stores
+ */
+struct trace_event
+{
+	uint32_t tick;
+	uint32_t pid;
+	uint16_t cpu;
+	uint16_t type;
+	int32_t arg;
+};
+
+/***********************************************************************
+ * Binary trace format
+ *
+ * DESCRIPTION
+ *   The header is followed by struct trace_events in the order they are
+ *   recorded. The numbers are in the native byte order.
+ */
+#define TRACE_MAGIC "SCHDTRCE"
+#define TRACE_VERSION 2
+
+struct trace_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t nr_processors;
+};
+
+/**
+ * # of events to buffer before writing them out
+ */
+#define TRACE_BUFFER_EVENTS 8192
+
+/***********************************************************************
+ * struct trace
+ *
+ * DESCRIPTION
+ *   Events being recorded into @stream. They are buffered in @events and
+ *   written out in a single fwrite when the buffer gets full, so the
+ *   simulation does not call into stdio for each event.
+ */
+struct trace
+{
+	struct trace_event *events;
+	unsigned int nr_events;
+	FILE *stream;
+};
+
+int trace_open(struct trace *t, FILE *stream, unsigned int nr_processors);
+int trace_flush(struct trace *t);
+int trace_close(struct trace *t);
+
+static inline void trace_record(struct trace *t, enum trace_type type,
+								unsigned int tick, unsigned int cpu, unsigned int pid, int arg)
+{
+	struct trace_event *ev;
+
+	if (t->nr_events == TRACE_BUFFER_EVENTS)
+		trace_flush(t);
+
+	ev = t->events + t->nr_events++;
+	ev->tick = tick;
+	ev->pid = pid;
+	ev->cpu = cpu;
+	ev->type = type;
+	ev->arg = arg;
+}
+
+/***********************************************************************
+ * trace_render()
+ *
+ * DESCRIPTION
+ *   Print @ev into @stream as the simulator prints events, with the CPU
+ *   column if @multi_cpu is true.
+ */
+void trace_render(FILE *stream, bool multi_cpu, const struct trace_event *ev);
+
+#endif